@@ -0,0 +1,287 @@
+#include <ges/dispatcher.hpp>
+
+#include <any>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+  struct Damage { uint32_t source, target; float amount; };
+
+  constexpr size_t LISTENERS = 4;
+  constexpr size_t EVENTS = 10000;
+  constexpr size_t FRAMES = 200;
+
+  // the listeners do a little work so the calls can't be dropped
+  volatile float sink = 0.f;
+
+  template<size_t N>
+  void on_damage(const Damage& damage) { sink = sink + damage.amount * float(N + 1); }
+
+  const Damage hit{ 1u, 2u, 10.f };
+
+  // a std::vector<std::function> per event type, events are queued by value until run
+  class function_observer {
+  public:
+    void listen(std::function<void(const Damage&)> listener) { listeners_.push_back(std::move(listener)); }
+
+    void emit(const Damage& damage) { queue_.push_back(damage); }
+
+    void trigger(const Damage& damage)
+    {
+      for (auto& listener : listeners_)
+        listener(damage);
+    }
+
+    void run()
+    {
+      for (const auto& damage : queue_)
+        trigger(damage);
+
+      queue_.clear();
+    }
+
+  private:
+    std::vector<std::function<void(const Damage&)>> listeners_;
+    std::vector<Damage> queue_;
+  };
+
+  // the classic observer interface
+  struct damage_listener {
+    virtual ~damage_listener() = default;
+    virtual void on(const Damage& damage) = 0;
+  };
+
+  template<size_t N>
+  struct damage_handler : damage_listener {
+    void on(const Damage& damage) override { on_damage<N>(damage); }
+  };
+
+  class virtual_observer {
+  public:
+    void listen(damage_listener* listener) { listeners_.push_back(listener); }
+
+    void emit(const Damage& damage) { queue_.push_back(damage); }
+
+    void trigger(const Damage& damage)
+    {
+      for (auto* listener : listeners_)
+        listener->on(damage);
+    }
+
+    void run()
+    {
+      for (const auto& damage : queue_)
+        trigger(damage);
+
+      queue_.clear();
+    }
+
+  private:
+    std::vector<damage_listener*> listeners_;
+    std::vector<Damage> queue_;
+  };
+
+  // a single queue of type erased events, listeners are looked up by type per event
+  class any_queue {
+  public:
+    using listener_type = std::function<void(const std::any&)>;
+
+    template<typename EventType>
+    void listen(void(*listener)(const EventType&))
+    {
+      listeners_[typeid(EventType)].push_back([listener](const std::any& event) {
+        listener(*std::any_cast<EventType>(&event));
+      });
+    }
+
+    template<typename EventType>
+    void emit(const EventType& event) { queue_.emplace_back(event); }
+
+    template<typename EventType>
+    void trigger(const EventType& event)
+    {
+      const std::any erased{ event };
+      dispatch(erased);
+    }
+
+    void run()
+    {
+      for (const auto& event : queue_)
+        dispatch(event);
+
+      queue_.clear();
+    }
+
+  private:
+    void dispatch(const std::any& event)
+    {
+      auto iter = listeners_.find(event.type());
+
+      if (iter == listeners_.end())
+        return;
+
+      for (auto& listener : iter->second)
+        listener(event);
+    }
+
+  private:
+    std::unordered_map<std::type_index, std::vector<listener_type>> listeners_;
+    std::vector<std::any> queue_;
+  };
+
+  // nanoseconds per event over FRAMES frames of EVENTS events
+  template<typename Function>
+  double measure(Function&& frame)
+  {
+    using clock = std::chrono::steady_clock;
+
+    frame(); // warm up
+
+    const auto start = clock::now();
+
+    for (size_t i = 0; i < FRAMES; ++i)
+      frame();
+
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / (FRAMES * EVENTS);
+  }
+
+  void report(const char* name, double queued, double immediate)
+  {
+    std::printf("%-24s %16.2f %16.2f\n", name, queued, immediate);
+  }
+
+  template<size_t... N>
+  void listen_all(ges::dispatcher& events, std::index_sequence<N...>)
+  {
+    (events.listen<Damage, on_damage<N>>(), ...);
+  }
+
+  template<size_t... N>
+  void listen_all(function_observer& observer, std::index_sequence<N...>)
+  {
+    (observer.listen([](const Damage& damage) { on_damage<N>(damage); }), ...);
+  }
+
+  template<size_t... N>
+  void listen_all(any_queue& queue, std::index_sequence<N...>)
+  {
+    (queue.listen<Damage>(&on_damage<N>), ...);
+  }
+
+}
+
+int main()
+{
+  constexpr auto listeners = std::make_index_sequence<LISTENERS>{};
+
+  std::printf("%zu listeners, %zu events per frame\n", LISTENERS, EVENTS);
+  std::printf("%-24s %16s %16s\n", "", "emit+run ns", "trigger ns");
+
+  {
+    ges::dispatcher events;
+    listen_all(events, listeners);
+
+    const double queued = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        events.emit<Damage>(hit);
+
+      events.run();
+    });
+
+    const double immediate = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        events.trigger<Damage>(hit);
+    });
+
+    report("ges::dispatcher", queued, immediate);
+
+    const double bus = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        events.emit_bus<Damage>(hit);
+
+      events.run_bus();
+    });
+
+    // the bus has no trigger, an event dispatched as soon as it is emitted is the closest
+    const double bus_immediate = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+      {
+        events.emit_bus<Damage>(hit);
+        events.run_bus();
+      }
+    });
+
+    report("ges::dispatcher bus", bus, bus_immediate);
+  }
+
+  {
+    function_observer observer;
+    listen_all(observer, listeners);
+
+    const double queued = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        observer.emit(hit);
+
+      observer.run();
+    });
+
+    const double immediate = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        observer.trigger(hit);
+    });
+
+    report("std::function", queued, immediate);
+  }
+
+  {
+    static_assert(LISTENERS == 4);
+
+    damage_handler<0> h0;
+    damage_handler<1> h1;
+    damage_handler<2> h2;
+    damage_handler<3> h3;
+
+    virtual_observer observer;
+
+    for (damage_listener* listener : std::initializer_list<damage_listener*>{ &h0, &h1, &h2, &h3 })
+      observer.listen(listener);
+
+    const double queued = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        observer.emit(hit);
+
+      observer.run();
+    });
+
+    const double immediate = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        observer.trigger(hit);
+    });
+
+    report("virtual interface", queued, immediate);
+  }
+
+  {
+    any_queue queue;
+    listen_all(queue, listeners);
+
+    const double queued = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        queue.emit(hit);
+
+      queue.run();
+    });
+
+    const double immediate = measure([&] {
+      for (size_t i = 0; i < EVENTS; ++i)
+        queue.trigger(hit);
+    });
+
+    report("std::any queue", queued, immediate);
+  }
+}
@@ -0,0 +1,96 @@
+#include <ges/dispatcher.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  using clock = std::chrono::steady_clock;
+
+  struct Ping { clock::time_point sent; };
+
+  std::atomic<int64_t> latency{ -1 };
+
+  void on_ping(const Ping& ping)
+  {
+    latency.store((clock::now() - ping.sent).count(), std::memory_order_release);
+  }
+
+  struct result {
+    double emit;    // ns spent in emit_bus by the producer
+    double median;  // ns from emit_bus to the listener
+    double p99;
+  };
+
+  // pings a consumer that has been idle for 'idle', long enough idle times let it park
+  result measure(ges::dispatcher& events, clock::duration idle, size_t samples)
+  {
+    std::vector<int64_t> latencies;
+    latencies.reserve(samples);
+
+    double emit = 0.0;
+
+    for (size_t i = 0; i < samples; ++i)
+    {
+      const auto until = clock::now() + idle;
+      while (clock::now() < until)
+        ges::cpu_relax();
+
+      latency.store(-1, std::memory_order_relaxed);
+
+      const auto start = clock::now();
+      events.emit_bus<Ping>(Ping{ start });
+      emit += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+      int64_t value;
+      // yields so that the consumer gets to run on machines with few cores
+      while ((value = latency.load(std::memory_order_acquire)) < 0)
+        std::this_thread::yield();
+
+      latencies.push_back(value);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    const auto to_ns = [](int64_t ticks) {
+      return std::chrono::duration<double, std::nano>(clock::duration(ticks)).count();
+    };
+
+    return result {
+      .emit   = emit / samples,
+      .median = to_ns(latencies[latencies.size() / 2]),
+      .p99    = to_ns(latencies[latencies.size() * 99 / 100])
+    };
+  }
+
+}
+
+int main()
+{
+  constexpr size_t SAMPLES = 2000;
+
+  std::printf("%10s %10s %12s %12s %12s\n", "spin", "idle us", "emit ns", "median ns", "p99 ns");
+
+  for (uint32_t spin : { 0u, 4096u, 1u << 16 })
+  {
+    ges::dispatcher events;
+    events.listen<Ping, on_ping>();
+    events.start_service();
+
+    std::thread consumer([&] { events.run_bus_blocking(spin); });
+
+    for (auto idle : { std::chrono::microseconds(0), std::chrono::microseconds(10), std::chrono::microseconds(200) })
+    {
+      const auto r = measure(events, idle, SAMPLES);
+
+      std::printf("%10u %10lld %12.0f %12.0f %12.0f\n", spin, static_cast<long long>(idle.count()), r.emit, r.median, r.p99);
+    }
+
+    events.stop_service();
+    consumer.join();
+  }
+}
@@ -0,0 +1,75 @@
+#include <ges/dispatcher.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+  struct Transform { float x, y, z, w; };
+  struct Damage { uint32_t source, target; float amount; };
+  struct Input { uint32_t player; uint32_t buttons; float axis[4]; };
+  struct Chat { std::string sender; std::string text; };
+
+  void on_transform(const Transform&) {}
+  void on_damage(const Damage&) {}
+  void on_input(const Input&) {}
+  void on_chat(const Chat&) {}
+
+  // the pending events of a frame, 'scale' times
+  void fill(ges::dispatcher& events, size_t scale)
+  {
+    for (size_t i = 0; i < 1000 * scale; ++i)
+      events.emit<Transform>(Transform{ 1.f, 2.f, 3.f, 4.f });
+
+    for (size_t i = 0; i < 100 * scale; ++i)
+      events.emit<Damage>(Damage{ 1u, 2u, 10.f });
+
+    for (size_t i = 0; i < 4 * scale; ++i)
+      events.emit_bus<Input>(Input{ 0u, 1u, { 0.f, 0.f, 0.f, 0.f } });
+
+    for (size_t i = 0; i < scale; ++i)
+      events.emit<Chat>(Chat{ "player", "gg wp" });
+  }
+
+  template<typename Function>
+  double measure(size_t iterations, Function&& function)
+  {
+    using clock = std::chrono::steady_clock;
+
+    const auto start = clock::now();
+
+    for (size_t i = 0; i < iterations; ++i)
+      function();
+
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+  }
+
+}
+
+int main()
+{
+  constexpr size_t ITERATIONS = 1000;
+
+  std::printf("%8s %12s %14s %14s\n", "scale", "bytes", "snapshot ns", "restore ns");
+
+  for (size_t scale : { 1u, 4u, 16u, 64u })
+  {
+    ges::dispatcher events;
+
+    events
+      .listen<Transform, on_transform>()
+      .listen<Damage, on_damage>()
+      .listen<Input, on_input>()
+      .listen<Chat, on_chat>();
+
+    fill(events, scale);
+
+    ges::frame_snapshot state;
+
+    const double snapshot = measure(ITERATIONS, [&] { events.snapshot(state); });
+    const double restore  = measure(ITERATIONS, [&] { events.restore(state); });
+
+    std::printf("%8zu %12zu %14.0f %14.0f\n", scale, state.size(), snapshot, restore);
+  }
+}
@@ -0,0 +1,300 @@
+#include <ges/dispatcher.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// mixes listen, unlisten, emit, batch, view, trigger and bus operations at random against one dispatcher,
+// while another thread listens and unlistens. Every mode runs on its own dispatcher: frame runs run and
+// run_bus on the main thread, service hands the bus to a consumer thread and parallel replaces run with
+// run_parallel. Build with -DGES_SANITIZE=address or thread to run it under a sanitizer.
+// Usage: bench_stress [operations] [seed] [frame|service|parallel|all]
+namespace {
+
+  struct Tick { uint64_t value; };
+  struct Hit { uint32_t source, target; float amount; };
+  struct Chat { std::string sender; std::string text; };
+
+  // every Tick reaches the witness, which is never unlistened
+  std::atomic<uint64_t> witnessed = 0;
+  std::atomic<uint64_t> handled = 0;
+
+  void witness(const Tick&) { witnessed.fetch_add(1, std::memory_order_relaxed); }
+
+  template<size_t N>
+  void on_tick(const Tick& tick) { handled.fetch_add(tick.value & 1u, std::memory_order_relaxed); }
+
+  template<size_t N>
+  void on_hit(const Hit& hit) { handled.fetch_add(hit.source == N, std::memory_order_relaxed); }
+
+  template<size_t N>
+  void on_chat(const Chat& chat) { handled.fetch_add(chat.text.size() > N, std::memory_order_relaxed); }
+
+  void view_hits(ges::viewer<Hit> hits) { handled.fetch_add(hits.size(), std::memory_order_relaxed); }
+
+  bool even(const Tick& tick) { return !(tick.value & 1u); }
+
+  // a listener slot that is either registered or not
+  struct slot {
+    void(*listen)(ges::dispatcher&, ges::execution_policy);
+    bool(*unlisten)(ges::dispatcher&);
+    bool listening = false;
+  };
+
+  template<typename EventType, auto func>
+  slot make_slot()
+  {
+    return slot {
+      .listen   = [](ges::dispatcher& events, ges::execution_policy policy) { events.listen<EventType, func>(policy); },
+      .unlisten = [](ges::dispatcher& events) { return events.unlisten<EventType, func>(); }
+    };
+  }
+
+  size_t peak_rss()
+  {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024u;
+#endif
+#endif
+  }
+
+  enum class run_mode { frame, service, parallel };
+
+  const char* name(run_mode mode)
+  {
+    switch (mode)
+    {
+    case run_mode::frame:   return "frame";
+    case run_mode::service: return "service";
+    default:            return "parallel";
+    }
+  }
+
+  // returns whether every Tick emitted reached the witness
+  bool stress(run_mode mode, size_t operations, uint32_t seed)
+  {
+    std::mt19937 random{ seed };
+
+    ges::dispatcher events;
+    ges::worker_pool workers;
+
+    witnessed = 0;
+
+    // trigger expects a registered type, the service expects every type registered before it starts
+    events
+      .listen<Tick, witness>()
+      .listen<Hit, on_hit<9>>()
+      .listen<Chat, on_chat<9>>();
+
+    // Tick and Hit share a level and run side by side in run_parallel
+    if (mode == run_mode::parallel)
+      events.set_workers(workers).set_phase<Chat>(1);
+
+    std::array<slot, 9> slots {
+      make_slot<Tick, on_tick<0>>(), make_slot<Tick, on_tick<1>>(), make_slot<Tick, on_tick<2>>(),
+      make_slot<Hit, on_hit<0>>(), make_slot<Hit, on_hit<1>>(), make_slot<Hit, on_hit<2>>(),
+      make_slot<Chat, on_chat<0>>(), make_slot<Chat, on_chat<1>>(), make_slot<Chat, on_chat<2>>()
+    };
+
+    // listens from another thread go through the snapshots or wait for the frame boundary
+    std::atomic<bool> done = false;
+
+    std::thread churn([&] {
+      std::mt19937 local{ seed + 1u };
+
+      while (!done.load(std::memory_order_relaxed))
+      {
+        if (local() & 1u)
+          events.listen<Hit, on_hit<7>>();
+        else
+          events.unlisten<Hit, on_hit<7>>();
+
+        std::this_thread::yield();
+      }
+    });
+
+    // the bus is dispatched by its own thread while the main thread keeps running frames
+    std::thread consumer;
+
+    if (mode == run_mode::service)
+    {
+      events.start_service();
+      consumer = std::thread([&] { events.run_bus_blocking(); });
+    }
+
+    const std::array<ges::execution_policy, 3> policies {
+      ges::execution_policy::immediate, ges::execution_policy::worker, ges::execution_policy::main
+    };
+
+    const auto run = [&] {
+      if (mode == run_mode::parallel)
+        events.run_parallel();
+      else
+        events.run();
+    };
+
+    uint64_t emitted = 0;
+    bool viewing = false;
+    bool filtered = false;
+
+    std::vector<Hit> hits(64, Hit{ 1u, 2u, 3.f });
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t op = 0; op < operations; ++op)
+    {
+      const uint32_t roll = random() % 100u;
+
+      if (roll < 30)
+      {
+        events.emit<Tick>(Tick{ random() });
+        ++emitted;
+      }
+      else if (roll < 40)
+      {
+        events.emit<Hit>(Hit{ static_cast<uint32_t>(random() % 3u), 0u, 1.f });
+      }
+      else if (roll < 45)
+      {
+        events.emit<Chat>(Chat{ "stress", std::string(random() % 32u, 'x') });
+      }
+      else if (roll < 60)
+      {
+        if (random() & 1u)
+        {
+          events.emit_bus<Tick>(Tick{ random() });
+          ++emitted;
+        }
+        else
+        {
+          events.emit_bus<Chat>(Chat{ "bus", "message long enough to allocate" });
+        }
+      }
+      else if (roll < 63)
+      {
+        events.emit_range<Hit>(hits.begin(), hits.end());
+      }
+      else if (roll < 65)
+      {
+        auto batch = events.batch<Tick>();
+
+        const size_t count = random() % 16u;
+
+        for (size_t i = 0; i < count; ++i)
+          batch.emplace_back(Tick{ i });
+
+        emitted += count;
+      }
+      else if (roll < 68)
+      {
+        events.trigger<Hit>(Hit{ 0u, 0u, 1.f });
+      }
+      else if (roll < 80)
+      {
+        auto& slot = slots[random() % slots.size()];
+
+        if (slot.listening)
+          slot.unlisten(events);
+        else
+          slot.listen(events, policies[random() % policies.size()]);
+
+        slot.listening = !slot.listening;
+      }
+      else if (roll < 81)
+      {
+        if (!viewing)
+          events.listen_view<Hit, view_hits>();
+
+        viewing = true;
+      }
+      else if (roll < 82)
+      {
+        if (filtered)
+          events.unlisten_if<Tick, on_tick<5>, even>();
+        else
+          events.listen_if<Tick, on_tick<5>, even>();
+
+        filtered = !filtered;
+      }
+      else if (roll < 92 && mode != run_mode::service)
+      {
+        events.run_bus();
+      }
+      else
+      {
+        run();
+      }
+    }
+
+    if (mode == run_mode::service)
+    {
+      events.stop_service();
+      consumer.join();
+    }
+    else
+    {
+      events.run_bus();
+    }
+
+    run();
+
+    done.store(true, std::memory_order_relaxed);
+    churn.join();
+
+    events.sync();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%s: %zu operations in %.3f s, %.0f ops/s\n", name(mode), operations, seconds, operations / seconds);
+    std::printf("%s: ticks emitted %llu, witnessed %llu\n", name(mode),
+      static_cast<unsigned long long>(emitted), static_cast<unsigned long long>(witnessed.load()));
+
+    return emitted == witnessed.load();
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  const size_t operations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+  const uint32_t seed = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : std::random_device{}();
+  const char* only = argc > 3 && std::strcmp(argv[3], "all") ? argv[3] : nullptr;
+
+  std::printf("seed %u\n", seed);
+
+  bool passed = true;
+
+  for (run_mode mode : { run_mode::frame, run_mode::service, run_mode::parallel })
+  {
+    if (!only || !std::strcmp(only, name(mode)))
+      passed = stress(mode, operations, seed) && passed;
+  }
+
+  std::printf("peak rss %.1f MiB\n", peak_rss() / (1024.0 * 1024.0));
+
+  return passed ? 0 : 1;
+}
@@ -1,10 +1,32 @@
 #pragma once
 #include "core.hpp"
+#include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
 
 namespace ges {
   // a type erased container
   class arena {
+  public:
+    // moves 'size' bytes worth of objects from src to dst, destroying the sources. 
+    // Objects are moved front to back, so dst may overlap src from the left
+    using relocate_type = void(*)(void* dst, void* src, size_t size);
+
+    template<typename T>
+    static void relocator(void* dst, void* src, size_t size)
+    {
+      T* to   = static_cast<T*>(dst);
+      T* from = static_cast<T*>(src);
+
+      for(size_t n = size / sizeof(T); n; --n, ++to, ++from)
+      {
+        ::new(to) T(std::move(*from));
+        from->~T();
+      }
+    }
+
   public:
     arena() = default;
   
@@ -18,6 +40,11 @@ namespace ges {
       _move(std::move(other));
     }
 
+    ~arena()
+    {
+      clear();
+    }
+
     arena& operator=(const arena& other)
     {
       if(this == &other)
@@ -26,6 +53,7 @@ namespace ges {
       }
 
       _copy(other);
+      return *this;
     }
 
     arena& operator=(arena&& other) noexcept
@@ -36,28 +64,87 @@ namespace ges {
       }
 
       _move(std::move(other));
+      return *this;
+    }
+
+    // objects that are not trivially copyable can't be moved around by memcpy
+    void set_relocator(relocate_type relocate)
+    {
+      relocate_ = relocate;
     }
 
+    relocate_type relocator() const { return relocate_; }
+
     template<typename T, typename... Args>
     T* construct(Args&&... args)
     {
-      if(sizeof(T) + size() > capacity())
-      {
-        reserve(sizeof(T) * empty() + (capacity() * 2));
-      }
+      _grow(sizeof(T));
 
+      ++version_;
       size_ += sizeof(T);
       return ::new(size_ - sizeof(T)) T{std::forward<Args>(args)...};
     }
 
+    // copies [first, first + count) to the end reserving once, 
+    // trivially copyable types are copied by a single memcpy
+    template<typename T>
+    T* append(const T* first, size_t count)
+    {
+      const size_t bytes = sizeof(T) * count;
+
+      _grow(bytes);
+
+      T* dst = reinterpret_cast<T*>(size_);
+
+      if constexpr (std::is_trivially_copyable_v<T>)
+      {
+        _memcopy(size_, first, bytes);
+      }
+      else
+      {
+        std::uninitialized_copy(first, first + count, dst);
+      }
+
+      ++version_;
+      size_ += bytes;
+      return dst;
+    }
+
+    // moves 'bytes' worth of objects from src to the end, destroying the sources
+    void relocate_back(void* src, size_t bytes)
+    {
+      _grow(bytes);
+      _relocate(size_, static_cast<byte*>(src), bytes);
+
+      ++version_;
+      size_ += bytes;
+    }
+
     template<typename Iterator>
     void insert(Iterator begin, Iterator end)
     {
-      using value_t = Iterator::value_type;
+      using value_t = typename std::iterator_traits<Iterator>::value_type;
       
-      for(; begin != end; ++begin)
+      if constexpr (std::contiguous_iterator<Iterator>)
+      {
+        append<value_t>(std::to_address(begin), static_cast<size_t>(end - begin));
+      }
+      else if constexpr (std::forward_iterator<Iterator>)
+      {
+        const size_t bytes = sizeof(value_t) * static_cast<size_t>(std::distance(begin, end));
+
+        _grow(bytes);
+
+        std::uninitialized_copy(begin, end, reinterpret_cast<value_t*>(size_));
+        ++version_;
+        size_ += bytes;
+      }
+      else
       {
-        construct<value_t>(*begin);
+        for(; begin != end; ++begin)
+        {
+          construct<value_t>(*begin);
+        }
       }
     }
 
@@ -78,6 +165,8 @@ namespace ges {
 
     void clear()
     {
+      ++version_;
+
       if(data_)
       {
         delete[] data_;
@@ -100,8 +189,10 @@ namespace ges {
         byte* new_data = new byte[ncapacity];
         size_t sz = size();
         
-        _memcopy(new_data, data_, sz);
+        _relocate(new_data, data_, sz);
         
+        delete[] data_;
+
         data_ = new_data;
         size_ = data_ + sz;
         capacity_ = data_ + ncapacity;
@@ -110,8 +201,54 @@ namespace ges {
 
     void reset()
     {
+      ++version_;
       size_ = data_;
     }
+
+    // reallocates to fit max(ncapacity, size()) bytes, releases the memory if nothing is left
+    void shrink(size_t ncapacity)
+    {
+      size_t sz = size();
+      ncapacity = std::max(ncapacity, sz);
+
+      if(ncapacity >= capacity())
+        return;
+
+      if(!ncapacity)
+      {
+        clear();
+        return;
+      }
+
+      byte* new_data = new byte[ncapacity];
+
+      _relocate(new_data, data_, sz);
+
+      delete[] data_;
+
+      data_ = new_data;
+      size_ = data_ + sz;
+      capacity_ = data_ + ncapacity;
+    }
+
+    void shrink_to_fit()
+    {
+      shrink(size());
+    }
+
+    // drops the first 'bytes' bytes, the caller is responsible for destroying them
+    void erase_front(size_t bytes)
+    {
+      size_t sz = size() - bytes;
+
+      if(relocate_)
+        relocate_(data_, data_ + bytes, sz);
+      else if(sz)
+        std::memmove(data_, data_ + bytes, sz);
+
+      ++version_;
+      size_ = data_ + sz;
+    }
     
     void resize(size_t nsize)
     {
@@ -119,6 +256,7 @@ namespace ges {
       {
         reserve(nsize);
       }
+      ++version_;
       size_ = data_ + nsize;
     }
 
@@ -128,10 +266,31 @@ namespace ges {
     // returns size in bytes
     size_t size() const { return static_cast<size_t>(size_ - data_); }
 
+    // bumped whenever objects are added, dropped or replaced, not when they are only moved to new memory
+    uint64_t version() const { return version_; }
+
   private:
-    void _memcopy(byte* dst, byte* src, size_t size)
+    void _memcopy(void* dst, const void* src, size_t size)
     {
-      std::memcpy(dst, src, size);
+      if(size)
+        std::memcpy(dst, src, size);
+    }
+
+    void _relocate(byte* dst, byte* src, size_t size)
+    {
+      if(relocate_)
+        relocate_(dst, src, size);
+      else
+        _memcopy(dst, src, size);
+    }
+
+    // grows geometrically so that at least 'bytes' more fit
+    void _grow(size_t bytes)
+    {
+      if(size() + bytes > capacity())
+      {
+        reserve(std::max(capacity() * 2, size() + bytes));
+      }
     }
       
     void _copy(const arena& src)
@@ -144,8 +303,10 @@ namespace ges {
       
       _memcopy(data_, src.data_, src.size());
       
+      ++version_;
       size_     = data_ + src.size();
       capacity_ = data_ + src.capacity();
+      relocate_ = src.relocate_;
     }
 
     void _move(arena&& other) noexcept
@@ -155,15 +316,19 @@ namespace ges {
       data_ = other.data_;
       size_ = other.size_;
       capacity_ = other.capacity_;
+      relocate_ = other.relocate_;
 
       other.data_ = nullptr;
       other.size_ = nullptr;
       other.capacity_ = nullptr;
+      ++other.version_;
     }
 
   private:
     byte* data_     = nullptr;
     byte* size_     = nullptr;
     byte* capacity_ = nullptr;
+    relocate_type relocate_ = nullptr;
+    uint64_t version_ = 0;
   };
 }
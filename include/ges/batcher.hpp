@@ -1,5 +1,6 @@
 #pragma once
 #include "arena.hpp"
+#include <span>
 
 namespace ges {
   
@@ -38,6 +39,11 @@ namespace ges {
     {
       arena_->insert(begin, end);
     }
+
+    void append(std::span<const event_type> events)
+    {
+      arena_->append(events.data(), events.size());
+    }
     
     void clear()
     {
@@ -0,0 +1,61 @@
+#pragma once
+#include "dispatcher.hpp"
+
+namespace ges {
+
+  // a typed handle to the events of one type, see dispatcher::channel.
+  // It points at the type directly so no call hashes or looks anything up
+  template<typename EventType>
+  class event_channel {
+    friend class dispatcher;
+  public:
+    using event_type = EventType;
+
+  public:
+    event_channel() = default;
+
+    // events are not stored while nobody would see them
+    template<typename... Args>
+    void emit(Args&&... args)
+    {
+      if (!subscribed())
+        return;
+
+      if (arena* pool = owner_->admit(*data_, sizeof(event_type)))
+        pool->template construct<event_type>(std::forward<Args>(args)...);
+    }
+
+    // the event is owned by the caller, every listener runs inline
+    void trigger(const event_type& event)
+    {
+      owner_->trigger(*data_, &event);
+    }
+
+    viewer<event_type> view()
+    {
+      return owner_->template view<event_type>(*data_);
+    }
+
+    batcher<event_type> batch()
+    {
+      return dispatcher::batch<event_type>(*data_);
+    }
+
+    bool subscribed() const
+    {
+      return data_->subscribed.load(std::memory_order_relaxed);
+    }
+
+    explicit operator bool() const { return data_ != nullptr; }
+
+  private:
+    event_channel(dispatcher& owner, dispatcher::event_data& data)
+      : owner_{&owner}, data_{&data}
+    { }
+
+  private:
+    dispatcher* owner_ = nullptr;
+    dispatcher::event_data* data_ = nullptr;
+  };
+
+} // namespace ges
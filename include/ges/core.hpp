@@ -3,6 +3,32 @@
 #include <cstdint>
 #include <utility>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
 namespace ges {
   using byte = unsigned char; 
+
+  // the parts of a pointer to data member
+  template<typename MemberPointer>
+  struct member_traits;
+
+  template<typename Class, typename Value>
+  struct member_traits<Value Class::*> {
+    using class_type = Class;
+    using value_type = Value;
+  };
+
+  // a hint for spin-wait loops
+  inline void cpu_relax()
+  {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+  }
 }
@@ -2,6 +2,8 @@
 
 namespace ges {
 
+  class dispatcher;
+
   struct event_delegate {
     using handler_type = void(*)(const void*, void*, void*);
     
@@ -24,7 +26,7 @@ namespace ges {
   }
 
   struct view_delegate {
-    using handler_type = void(*)(class dispatcher*, void*, void*);
+    using handler_type = void(*)(ges::dispatcher*, void*, void*);
     
     friend bool operator==(const view_delegate& lhs, const view_delegate& rhs)
     {
@@ -38,7 +40,7 @@ namespace ges {
     }
 
     handler_type handler;
-    dispatcher* dispatcher;
+    ges::dispatcher* dispatcher;
     void* function;
     void* payload;
   };
@@ -4,19 +4,61 @@
 #include "delegate.hpp"
 #include "batcher.hpp"
 #include "viewer.hpp"
+#include "policy.hpp"
+#include "listener_list.hpp"
+#include "worker_pool.hpp"
+#include "tracer.hpp"
+#include "snapshot.hpp"
+#include "frame_allocator.hpp"
+#include "sort.hpp"
+#include "state.hpp"
+#include <metaq.hpp>
 
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
 #include <cassert>
 
 namespace ges {
 
+  template<typename EventType>
+  class event_channel;
+
   class dispatcher {
+    template<typename> friend class event_channel;
+
     using self_type = dispatcher;
+    struct event_data;
+    struct external_segment;
+    struct bus_lane;
+    struct detached_batch;
+    struct pipeline;
+  public:
+    using release_type = void(*)(void* context);
+    using clock_type   = std::chrono::steady_clock;
+
+    static constexpr uint32_t NO_LANE = ~0u;
+
   public:
     dispatcher()
+      : owner_{std::this_thread::get_id()}
+    {
+      lanes_.emplace_back();
+      lanes_.front().queue.create();
+    }
+
+    // the batches still on the workers are joined
+    ~dispatcher()
     {
-      queue_.create();
+      join();
     }
 
     template<typename EventType, auto func>
@@ -26,33 +68,40 @@ namespace ges {
 
       using event_type = EventType;
 
-      secure<event_type>().viewers.push_back(wrap_view<event_type, func>());
+      auto& data = secure<event_type>();
+
+      // listens from other threads refresh the type under the registry lock
+      std::lock_guard lock{registry_};
+
+      data.viewers.push_back(wrap_view<event_type, func>());
+      refresh(data);
       return *this;
     }
 
+    // listeners run inline by default, see execution_policy for offloaded and deferred ones
     template<typename EventType, auto func>
-    self_type& listen()
+    self_type& listen(execution_policy policy = execution_policy::immediate)
     {
       static_assert(!is_viewer<EventType>::value, "ges::viewer<T> can\'t be registered as event type");
       static_assert(!is_batcher<EventType>::value, "ges::batcher<T> can\'t be registered as event type");
 
       using event_type = EventType;
 
-      secure<event_type>().listeners.push_back(wrap<event_type, func>());
+      subscribe<event_type>(wrap<event_type, func>(), policy);
       return *this;
     }
 
     template<typename EventType, auto func, typename Instance>
-    self_type& listen(Instance* instance)
+    self_type& listen(Instance* instance, execution_policy policy = execution_policy::immediate)
     {
       using event_type = EventType;
 
-      secure<event_type>().listeners.push_back(wrap<event_type, func>(instance));
+      subscribe<event_type>(wrap<event_type, func>(instance), policy);
       return *this;
     }
 
     template<typename EventType, typename Callable>
-    self_type& listen(Callable callable)
+    self_type& listen(Callable callable, execution_policy policy = execution_policy::immediate)
     {
       using callable_type = Callable;
       using event_type = EventType;
@@ -60,12 +109,12 @@ namespace ges {
       static_assert((std::is_pointer_v<callable_type> || std::is_empty_v<callable_type>),
         "stateful functor objects are not supported yet");
 
-      secure<event_type>().listeners.push_back(wrap<event_type>(callable));
+      subscribe<event_type>(wrap<event_type>(callable), policy);
       return *this;
     }
 
     template<typename EventType, typename Callable, typename Instance>
-    self_type& listen(Callable callable, Instance* instance)
+    self_type& listen(Callable callable, Instance* instance, execution_policy policy = execution_policy::immediate)
     {
       using callable_type = Callable;
       using event_type = EventType;
@@ -76,11 +125,135 @@ namespace ges {
       static_assert(std::is_pointer_v<callable_type> || std::is_empty_v<callable_type>,
         "Only functor pointers, stateless functor objects and function pointers are allowed");
 
-      secure<event_type>().listeners.push_back(wrap<event_type>(callable, instance));
+      subscribe<event_type>(wrap<event_type>(callable, instance), policy);
+
+      return *this;
+    }
+
+    // 'func' only sees the events 'pred' accepts, the predicate is called by the same wrapper
+    template<typename EventType, auto func, auto pred>
+    self_type& listen_if(execution_policy policy = execution_policy::immediate)
+    {
+      using event_type = EventType;
+
+      subscribe<event_type>(wrap_if<event_type, func, pred>(), policy);
+      return *this;
+    }
+
+    template<typename EventType, auto func, auto pred, typename Instance>
+    self_type& listen_if(Instance* instance, execution_policy policy = execution_policy::immediate)
+    {
+      using event_type = EventType;
+
+      subscribe<event_type>(wrap_if<event_type, func, pred>(instance), policy);
+      return *this;
+    }
+
+    template<typename EventType, typename Predicate, typename Callable>
+    self_type& listen_if(Predicate pred, Callable callable, execution_policy policy = execution_policy::immediate)
+    {
+      using event_type = EventType;
+
+      static_assert((std::is_pointer_v<Predicate> || std::is_empty_v<Predicate>) && 
+        (std::is_pointer_v<Callable> || std::is_empty_v<Callable>),
+        "Only functor pointers, stateless functor objects and function pointers are allowed");
+
+      subscribe<event_type>(wrap_if<event_type>(pred, callable), policy);
+      return *this;
+    }
+
+    // 'func' only sees the events whose 'member' equals 'value'. The listeners filtering the same member 
+    // share a single listener that reads it once and calls the matching ones, they always run inline
+    template<typename EventType, auto member, auto func>
+    self_type& listen_when(const typename member_traits<decltype(member)>::value_type& value)
+    {
+      using event_type = EventType;
+
+      filter<event_type, member>(value, wrap<event_type, func>(), true);
+      return *this;
+    }
+
+    template<typename EventType, auto member, auto func, typename Instance>
+    self_type& listen_when(const typename member_traits<decltype(member)>::value_type& value, Instance* instance)
+    {
+      using event_type = EventType;
+
+      filter<event_type, member>(value, wrap<event_type, func>(instance), true);
+      return *this;
+    }
+
+    // the listeners of Base see the events of Derived too. They are copied into the listeners of Derived
+    // and kept in sync, so dispatching Derived walks a single flat list. Base has to be at offset 0 of Derived
+    template<typename Derived, typename Base>
+    self_type& inherit()
+    {
+      static_assert(std::is_base_of_v<Base, Derived> && !std::is_same_v<Base, Derived>, 
+        "Derived has to inherit from Base");
+
+      assert((base_offset<Derived, Base>() == 0) && "Base has to be at offset 0 of Derived");
+
+      auto& derived = secure<Derived>();
+      auto& base = secure<Base>();
+
+      std::lock_guard lock{registry_};
+
+      if (std::find(base.derived.begin(), base.derived.end(), &derived) != base.derived.end())
+        return *this;
+
+      base.derived.push_back(&derived);
+      derived.bases.push_back(&base);
+
+      for (auto policy : { execution_policy::immediate, execution_policy::worker, execution_policy::main })
+      {
+        for (const auto& delegate : list(base, policy).snapshot())
+          attach(derived, delegate, policy);
+      }
+
+      return *this;
+    }
+
+    // a consumer receives EventType&& and runs as the final stage of a batch, 
+    // after every listener has seen it. There is at most one per type, set like a listener
+    // from any thread and seen from the next pass on
+    template<typename EventType, auto func>
+    self_type& listen_consume()
+    {
+      using event_type = EventType;
+
+      consume<event_type>(wrap_consume<event_type, func>(), true);
+      return *this;
+    }
+
+    template<typename EventType, auto func, typename Instance>
+    self_type& listen_consume(Instance* instance)
+    {
+      using event_type = EventType;
+
+      consume<event_type>(wrap_consume<event_type, func>(instance), true);
+      return *this;
+    }
+
+    template<typename EventType, typename Callable>
+    self_type& listen_consume(Callable callable)
+    {
+      using callable_type = Callable;
+      using event_type = EventType;
+
+      static_assert(std::is_pointer_v<callable_type> || std::is_empty_v<callable_type>,
+        "Only functor pointers, stateless functor objects and function pointers are allowed");
 
+      consume<event_type>(wrap_consume<event_type>(callable), true);
       return *this;
     }
 
+    template<typename EventType>
+    bool unlisten_consume()
+    {
+      using event_type = EventType;
+
+      return consume<event_type>(event_delegate{}, false);
+    }
+
     template<typename EventType, auto func>
     bool unlisten()
     {
@@ -88,7 +261,7 @@ namespace ges {
 
       auto delegate = wrap<event_type, func>();
 
-      return try_erase_one(delegate, mq::meta<event_type>().hash);
+      return unsubscribe(delegate, mq::meta<event_type>().hash);
     }
 
     template<typename EventType, auto func, typename Instance>
@@ -98,7 +271,7 @@ namespace ges {
 
       auto delegate = wrap<event_type, func>(instance);
 
-      return try_erase_one(delegate, mq::meta<event_type>().hash);
+      return unsubscribe(delegate, mq::meta<event_type>().hash);
     }
 
     template<typename EventType, typename Callable>
@@ -109,7 +282,7 @@ namespace ges {
 
       auto delegate = wrap<event_type>(callable);
 
-      return try_erase_one(delegate, mq::meta<event_type>().hash);
+      return unsubscribe(delegate, mq::meta<event_type>().hash);
     }
 
     template<typename EventType, typename Callable, typename Instance>
@@ -120,7 +293,47 @@ namespace ges {
 
       auto delegate = wrap<event_type>(callable, instance);
 
-      return try_erase_one(delegate, mq::meta<event_type>().hash);
+      return unsubscribe(delegate, mq::meta<event_type>().hash);
+    }
+
+    template<typename EventType, auto func, auto pred>
+    bool unlisten_if()
+    {
+      using event_type = EventType;
+
+      return unsubscribe(wrap_if<event_type, func, pred>(), mq::meta<event_type>().hash);
+    }
+
+    template<typename EventType, auto func, auto pred, typename Instance>
+    bool unlisten_if(Instance* instance)
+    {
+      using event_type = EventType;
+
+      return unsubscribe(wrap_if<event_type, func, pred>(instance), mq::meta<event_type>().hash);
+    }
+
+    template<typename EventType, typename Predicate, typename Callable>
+    bool unlisten_if(Predicate pred, Callable callable)
+    {
+      using event_type = EventType;
+
+      return unsubscribe(wrap_if<event_type>(pred, callable), mq::meta<event_type>().hash);
+    }
+
+    template<typename EventType, auto member, auto func>
+    bool unlisten_when(const typename member_traits<decltype(member)>::value_type& value)
+    {
+      using event_type = EventType;
+
+      return filter<event_type, member>(value, wrap<event_type, func>(), false);
+    }
+
+    template<typename EventType, auto member, auto func, typename Instance>
+    bool unlisten_when(const typename member_traits<decltype(member)>::value_type& value, Instance* instance)
+    {
+      using event_type = EventType;
+
+      return filter<event_type, member>(value, wrap<event_type, func>(instance), false);
     }
 
     template<typename EventType>
@@ -132,9 +345,24 @@ namespace ges {
       if (iter == events_.end())
         return;
 
+      // detached batches may still refer to the type
+      join();
+      release_external(iter->second);
+
+      std::replace(budget_order_.begin(), budget_order_.end(), &iter->second, (event_data*)nullptr);
+
+      // the pool is freed with the type
+      reserved_ -= std::min(reserved_.load(), iter->second.pool.capacity());
+
+      std::lock_guard lock{registry_};
+      unlink(iter->second);
+      index_[iter->second.info.index] = nullptr;
       events_.erase(iter);
+      replan_ = true;
     }
 
+    // the event is owned by the caller, so the consumer is not invoked 
+    // and every listener runs inline whatever its execution policy
     template<typename EventType>
     void trigger(const EventType& event)
     {
@@ -144,390 +372,2808 @@ namespace ges {
       
       assert(iter != events_.end());
 
-      auto& handlers = iter->second.listeners;
-
-      if constexpr (std::is_trivially_destructible_v<event_type>)
-      {
-        for (auto i = handlers.size(); i; --i)
-          handlers[i - 1u](&event);
-      }
-      else
-      {
-        for (auto i = handlers.size(); i > 1; --i)
-          handlers[i - 1u](&event);
-      }
+      trigger(iter->second, &event);
     }
 
     template<typename EventType, typename... Args>
     void emit_bus(Args&&... args)
     {
-      queue_.push<EventType>(std::forward<Args>(args)...);
+      try_emit_bus<EventType>(std::forward<Args>(args)...);
     }
 
     template<typename EventType>
     void emit_bus(EventType&& event)
     {
-      queue_.push<EventType>(std::forward<EventType>(event));
+      try_emit_bus<EventType>(std::forward<EventType>(event));
     }
 
+    // returns false if the bus is over budget and the event is dropped,
+    // an event nobody is subscribed to is skipped and isn't a failure
     template<typename EventType, typename... Args>
-    void emit(Args&&... args)
+    bool try_emit_bus(Args&&... args)
     {
-      auto& data = events_.at(mq::meta<EventType>::hash);
+      using event_type = std::remove_cvref_t<EventType>;
+
+      auto* data = subscribed<event_type>();
+
+      if (!data)
+        return true;
 
-      data.pool.construct<EventType>(std::forward<Args>(args)...);
+      return push_bus<event_type>(lane_of(*data), std::forward<Args>(args)...);
     }
 
     template<typename EventType>
-    void emit(EventType&& event)
+    bool try_emit_bus(EventType&& event)
     {
-      auto& data = events_.at(mq::meta<EventType>::hash);
+      using event_type = std::remove_cvref_t<EventType>;
+
+      auto* data = subscribed<event_type>();
 
-      data.pool.construct<EventType>(std::forward<EventType>(event));
+      if (!data)
+        return true;
+
+      return push_bus<event_type>(lane_of(*data), std::forward<EventType>(event));
     }
 
-    template<typename EventType>
-    bool contains()
+    // emits to a given lane instead of the lane of the type
+    template<typename EventType, typename... Args>
+    bool emit_bus_to(uint32_t lane, Args&&... args)
     {
       using event_type = EventType;
 
-      auto iter = events_.find(mq::meta<event_type>::hash);
+      if (!subscribed<event_type>())
+        return true;
 
-      return iter != events_.end();
+      return push_bus<event_type>(std::min<size_t>(lane, lanes_.size() - 1u), std::forward<Args>(args)...);
+    }
+
+    // events of a type without listeners, viewers or a consumer are not stored
+    template<typename EventType, typename... Args>
+    void emit(Args&&... args)
+    {
+      try_emit<EventType>(std::forward<Args>(args)...);
     }
 
     template<typename EventType>
-    viewer<EventType> view()
+    void emit(EventType&& event)
     {
-      using event_type = EventType;
-      auto iter = events_.find(mq::meta<event_type>::hash);
+      try_emit<EventType>(std::forward<EventType>(event));
+    }
 
-      if (iter == events_.end())
-        return viewer<event_type>();
+    // returns false if the budget of the type drops the event, see pool_policy.
+    // An event nobody is subscribed to is skipped and isn't a failure
+    template<typename EventType, typename... Args>
+    bool try_emit(Args&&... args)
+    {
+      auto* data = subscribed<EventType>();
 
-      auto& arena = iter->second.pool;
+      if (!data)
+        return true;
 
-      auto size = arena.size() / sizeof(event_type);
-      return viewer<event_type>((event_type*)arena.data(), size);
+      arena* pool = admit(*data, sizeof(EventType));
+
+      if (!pool)
+        return false;
+
+      pool->template construct<EventType>(std::forward<Args>(args)...);
+      return true;
     }
 
     template<typename EventType>
-    batcher<EventType> batch()
+    bool try_emit(EventType&& event)
     {
-      auto& arena = events_[mq::meta<EventType>::hash].pool;
+      using event_type = std::remove_cvref_t<EventType>;
 
-      return batcher<EventType>(arena);
+      auto* data = subscribed<event_type>();
+
+      if (!data)
+        return true;
+
+      arena* pool = admit(*data, sizeof(event_type));
+
+      if (!pool)
+        return false;
+
+      pool->template construct<event_type>(std::forward<EventType>(event));
+      return true;
     }
 
-    template<typename EventType>
-    void run()
+    // factory() -> EventType only runs when the event is going to be stored
+    template<typename EventType, typename Factory>
+    void emit_lazy(Factory&& factory)
     {
-      auto it = events_.find(mq::meta<EventType>::hash);
+      auto* data = subscribed<EventType>();
 
-      assert(it != events_.end());
+      if (!data)
+        return;
 
-      auto& data = it->second;
+      if (arena* pool = admit(*data, sizeof(EventType)))
+        pool->template construct<EventType>(factory());
+    }
 
-      auto& pool = data.pool;
-      const auto& handlers = data.listeners;
+    // dispatches caller owned events in place with the next pass over EventType, 
+    // release(context) is called once they are dispatched so the buffer can be recycled.
+    // Viewers see one segment at a time and the consumer doesn't see them
+    template<typename EventType>
+    void submit_external(std::span<const EventType> events, release_type release = nullptr, void* context = nullptr)
+    {
+      using event_type = EventType;
 
-      if (pool.empty())
-        return;
+      static_assert(std::is_trivially_copyable_v<event_type>, "only trivially copyable events can be submitted in place");
 
-      for (auto& viewer : data.viewers)
-      {
-        viewer();
-      }
+      auto* data = subscribed<event_type>();
 
-#if 0
-      if (!handlers.empty())
+      if (!data || events.empty())
       {
-        auto size = pool.size();
-        for (size_t i = 0; i < size; i += data.info.size)
-        {
-          for (auto pos = handlers.size(); pos; --pos)
-          {
-            auto& handler = handlers[pos - 1u];
-            const void* event = pool.get(i);
-            handler(event);
-          }
-        }
+        if (release)
+          release(context);
+        return;
       }
 
-#else
-      for (auto pos = handlers.size(); pos; --pos)
-      {
-        auto& handler = handlers[pos - 1u];
-        auto size = pool.size();
-        for (size_t i = 0; i < size; i += data.info.size)
-        {
-          const void* event = pool.get(i);
-          handler(event);
-        }
-      }
-#endif // 0
-      pool.reset();
+      data->external.push_back(external_segment {
+        .data    = events.data(),
+        .size    = events.size_bytes(),
+        .release = release,
+        .context = context
+      });
     }
 
-    void run()
+    template<typename EventType, typename Iterator>
+    void emit_range(Iterator first, Iterator last)
     {
-      for (auto& [type, data] : events_)
+      using event_type = EventType;
+
+      static_assert(std::is_same_v<typename std::iterator_traits<Iterator>::value_type, event_type>,
+        "emit_range expects a range of EventType");
+
+      auto* data = subscribed<event_type>();
+
+      if (!data)
+        return;
+
+      // the growth still counts against a budget set later
+      if (!budget_ && !data->policy.budget)
       {
-        auto& pool = data.pool;
-        const auto& handlers = data.listeners;
-        
-        if (pool.empty())
-          continue;
+        const size_t capacity = data->pool.capacity();
 
-        for (auto& viewer : data.viewers)
-        {
-          viewer();
-        }
-        
-      #if 1
-        if (!handlers.empty())
-        {
-          auto size = pool.size();
-          for (size_t i = 0; i < size; i += data.info.size)
-          {
-            for (auto pos = handlers.size(); pos; --pos)
-            {
-              auto& handler = handlers[pos - 1u];
-              const void* event = pool.get(i);
-              handler(event);
-            }
-          }
-        }
+        data->pool.insert(first, last);
+        reserved_ += data->pool.capacity() - capacity;
+        return;
+      }
 
-      #else
-        for (auto pos = handlers.size(); pos; --pos)
-        {
-          auto& handler = handlers[pos - 1u];
-          auto size = pool.size();
-          for (size_t i = 0; i < size; i += data.info.size)
-          {
-            const void* event = pool.get(i);
-            handler(event);
-          }
-        }
-      #endif // 0
-        pool.reset();
+      for (; first != last; ++first)
+      {
+        if (arena* pool = admit(*data, sizeof(event_type)))
+          pool->template construct<event_type>(*first);
       }
     }
 
-    void run_bus()
+    template<typename EventType, typename Iterator>
+    void emit_bus_range(Iterator first, Iterator last)
     {
-      while (!queue_.empty())
-      {
-        const uint32_t& type = queue_.check();
-
-        auto& data = events_.at(type);
+      using event_type = EventType;
 
-        const void* event = queue_.peek();
+      static_assert(std::is_same_v<typename std::iterator_traits<Iterator>::value_type, event_type>,
+        "emit_bus_range expects a range of EventType");
 
-        auto& handlers = data.listeners;
+      auto* data = subscribed<event_type>();
 
-        auto size = handlers.size();
-        for (auto pos = size; pos; --pos)
-        {
-          auto& handler = handlers[pos - 1u];
-          handler(event);
-        }
+      if (!data)
+        return;
 
-        queue_.pop(data.info.size);
+      if (!bus_policy_.byte_budget && !bus_policy_.event_budget && !service_.load(std::memory_order_relaxed))
+      {
+        lanes_[lane_of(*data)].queue.template push_range<event_type>(first, last);
+        return;
       }
-      queue_.reset();
+
+      for (; first != last; ++first)
+        try_emit_bus<event_type>(*first);
     }
-    
-  private:
+
+    // budgets are checked by emit, batches write to the pool directly and bypass them
     template<typename EventType>
-    auto& secure()
+    self_type& set_policy(const pool_policy& policy)
     {
       using event_type = EventType;
-      constexpr auto type = mq::meta<event_type>().hash;
 
-      auto iter = events_.find(type);
-      if (iter == events_.end())
-      {
-        auto& event_data = events_[type];
-        
-        event_data.info = event_info {
-          .name = mq::meta<event_type>().name,
-          .type = type,
-          .size = sizeof(event_type)
-        };
+      secure<event_type>().policy = policy;
+      return *this;
+    }
 
-        if constexpr (!std::is_trivially_destructible_v<event_type>)
-        {
-          auto& listeners = event_data.listeners;
+    // a byte budget shared by every per-type pool, 0 is unbounded
+    self_type& set_budget(size_t budget)
+    {
+      budget_ = budget;
+      return *this;
+    }
 
-          if (listeners.empty())
-          {
-            event_delegate destroy {
-              .handler  = destructor<event_type>(),
-              .function = destructor<event_type>(),
-              .payload  = nullptr
-            };
-            listeners.push_back(destroy);
-          }
-        }
-        return event_data;
+    // the budgets count the events of every lane
+    self_type& set_bus_policy(const bus_policy& policy)
+    {
+      bus_policy_ = policy;
+      return *this;
+    }
+
+    // splits the bus into 'count' lanes with pages of their own, lane 0 has the highest priority.
+    // Types without a lane of their own go to 'default_lane'. The bus has to be empty
+    self_type& set_lanes(size_t count, lane_order order = lane_order::strict, uint32_t default_lane = 0)
+    {
+      assert(count && default_lane < count);
+      assert(!lanes_pending() && "lanes can't be changed while events are pending");
+
+      while (lanes_.size() > count)
+        lanes_.pop_back();
+
+      while (lanes_.size() < count)
+      {
+        auto& lane = lanes_.emplace_back();
+        lane.queue.create();
+
+        if (service_.load(std::memory_order_relaxed))
+          lane.service.create();
+      }
+
+      lane_order_ = order;
+      default_lane_ = default_lane;
+      return *this;
+    }
+
+    // the events a lane dispatches per turn with lane_order::weighted
+    self_type& set_lane_weight(size_t lane, uint32_t weight)
+    {
+      assert(lane < lanes_.size() && weight);
+
+      lanes_[lane].weight = weight;
+      return *this;
+    }
+
+    // the lane bus events of EventType go to unless emitted with emit_bus_to
+    template<typename EventType>
+    self_type& set_lane(uint32_t lane)
+    {
+      using event_type = EventType;
+
+      secure<event_type>().lane = lane;
+      return *this;
+    }
+
+    bus_stats stats_bus() const
+    {
+      auto stats = bus_stats_;
+
+      stats.reserved = spill_.reserved();
+      stats.used     = spill_.used();
+      stats.pending  = spill_.pending();
+
+      for (const auto& lane : lanes_)
+      {
+        stats.reserved += lane.queue.reserved();
+        stats.used     += lane.queue.used();
+        stats.pending  += lane.queue.pending();
+      }
+
+      return stats;
+    }
+
+    // releases the memory not used by pending events
+    void trim()
+    {
+      for (auto& lane : lanes_)
+      {
+        if (lane.queue.empty())
+          lane.queue.shrink(1u);
+      }
+
+      reserved_ = 0;
+
+      for (auto& [type, data] : events_)
+      {
+        data.pool.shrink_to_fit();
+        data.stats.peak = 0;
+        data.frames = 0;
+
+        reserved_ += data.pool.capacity();
+      }
+    }
+
+    template<typename EventType>
+    pool_stats stats() const
+    {
+      using event_type = EventType;
+
+      auto iter = events_.find(mq::meta<event_type>::hash);
+
+      if (iter == events_.end())
+        return pool_stats{};
+
+      return collect(iter->second);
+    }
+
+    pool_stats stats() const
+    {
+      pool_stats total;
+
+      for (const auto& [type, data] : events_)
+      {
+        auto stats = collect(data);
+
+        total.reserved += stats.reserved;
+        total.used     += stats.used;
+        total.peak     += stats.peak;
+        total.rejected += stats.rejected;
+        total.dropped  += stats.dropped;
+        total.spilled  += stats.spilled;
+      }
+
+      return total;
+    }
+
+    // bytes the pools hold against the budget of set_budget
+    size_t reserved() const
+    {
+      return reserved_;
+    }
+
+    template<typename EventType>
+    bool contains()
+    {
+      using event_type = EventType;
+
+      auto iter = events_.find(mq::meta<event_type>::hash);
+
+      return iter != events_.end();
+    }
+
+    template<typename EventType>
+    viewer<EventType> view()
+    {
+      using event_type = EventType;
+      auto iter = events_.find(mq::meta<event_type>::hash);
+
+      if (iter == events_.end())
+        return viewer<event_type>();
+
+      return view<event_type>(iter->second);
+    }
+
+    // the events of EventType ordered by 'member', stable. The events don't move, a permutation of them is
+    // radix sorted and shared by every caller until the events of the type change, so once per run at most
+    template<typename EventType, auto member>
+    sorted_viewer<EventType, member> view_sorted()
+    {
+      using event_type = EventType;
+      using key_type = typename member_traits<decltype(member)>::value_type;
+
+      static_assert(std::is_base_of_v<typename member_traits<decltype(member)>::class_type, event_type>,
+        "member has to be a field of EventType");
+
+      auto* data = find<event_type>();
+
+      if (!data)
+        return {};
+
+      const auto events = view<event_type>(*data);
+
+      // identifies the key of the type
+      static const char tag = 0;
+
+      auto iter = std::find_if(data->sorted.begin(), data->sorted.end(), [](const sort_cache& cache) {
+        return cache.key == &tag;
+      });
+
+      if (iter == data->sorted.end())
+      {
+        iter = data->sorted.emplace(iter);
+        iter->key = &tag;
+      }
+
+      auto& cache = *iter;
+
+      if (cache.version != data->pool.version() || cache.base != events.data() || cache.order.size() != events.size())
+      {
+        cache.keys.resize(events.size());
+
+        for (size_t i = 0; i < events.size(); ++i)
+          cache.keys[i] = radix_key(events.at(i).*member);
+
+        cache.sorter.sort(cache.keys, cache.order, sizeof(key_type));
+
+        cache.version = data->pool.version();
+        cache.base = events.data();
+      }
+
+      return sorted_viewer<event_type, member>(events.data(), cache.order.data(), cache.keys.data(), cache.order.size());
+    }
+
+    template<typename EventType>
+    batcher<EventType> batch()
+    {
+      auto& arena = secure<EventType>().pool;
+
+      return batcher<EventType>(arena);
+    }
+
+    // a handle to EventType that emits, triggers, views and batches without looking the type up.
+    // It stays valid until the type is cleared
+    template<typename EventType>
+    event_channel<EventType> channel()
+    {
+      static_assert(!is_viewer<EventType>::value && !is_batcher<EventType>::value, 
+        "expected T instead of ges::viewer<T> or ges::batcher<T>");
+
+      return event_channel<EventType>(*this, secure<EventType>());
+    }
+
+    // EventType becomes a state: publish keeps the latest value of each of 'slots' keys instead of
+    // queueing events, and the listeners see a key at most once per run, only if its value changed.
+    // Listeners of state_update<EventType> get the key along with the value.
+    // The channel stays valid until the type is cleared
+    template<typename EventType>
+    state_channel<EventType>& set_state(size_t slots = 1)
+    {
+      using event_type = EventType;
+
+      auto& data = secure<event_type>();
+
+      // other threads look the state up under the registry lock
+      std::lock_guard lock{registry_};
+
+      if (!data.state)
+      {
+        data.state = std::make_shared<state_channel<event_type>>(slots);
+        data.drain_state = +[](dispatcher& self, event_data& data) {
+          auto* keyed = self.subscribed<state_update<event_type>>();
+
+          static_cast<state_channel<event_type>*>(data.state.get())->drain([&](size_t key, const event_type& value) {
+            self.trigger(data, &value);
+
+            if (keyed)
+            {
+              const state_update<event_type> update{ key, value };
+              self.trigger(*keyed, &update);
+            }
+          });
+        };
+      }
+
+      auto& channel = *static_cast<state_channel<event_type>*>(data.state.get());
+
+      assert(channel.size() == slots && "the state is declared with another number of slots");
+      return channel;
+    }
+
+    // the latest value of a state. Any thread may look it up, the registry is locked while the main
+    // thread may be registering types, so threads publishing or reading every tick should keep the
+    // channel returned by set_state instead
+    template<typename EventType>
+    state_channel<EventType>& state()
+    {
+      std::lock_guard lock{registry_};
+
+      auto iter = events_.find(mq::meta<EventType>().hash);
+
+      assert(iter != events_.end() && iter->second.state && "the type is not a state, see set_state");
+      return *static_cast<state_channel<EventType>*>(iter->second.state.get());
+    }
+
+    // returns false if the value didn't change, looks the state up like state()
+    template<typename EventType>
+    bool publish(size_t key, const EventType& value)
+    {
+      return state<EventType>().publish(key, value);
+    }
+
+    template<typename EventType>
+    bool publish(const EventType& value)
+    {
+      return state<EventType>().publish(value);
+    }
+
+    // dispatches a single type like run() does as part of a frame, and closes the frame
+    template<typename EventType>
+    void run()
+    {
+      assert(!cursor_.active && "a run_for pass is pending");
+
+      auto it = events_.find(mq::meta<EventType>::hash);
+
+      assert(it != events_.end());
+
+      dispatching_ = true;
+
+      process(it->second);
+      settle(it->second);
+
+      dispatching_ = false;
+
+      sync();
+    }
+
+    // dispatches every type following the pipeline schedule, see set_phase and emits
+    void run()
+    {
+      assert(!cursor_.active && "a run_for pass is pending");
+
+      dispatching_ = true;
+
+      for (auto* data : schedule().order)
+      {
+        process(*data);
+        settle(*data);
+      }
+
+      dispatching_ = false;
+
+      sync();
+    }
+
+    // dispatches like run() until 'budget' is spent, the next call resumes from the same event and listener.
+    // Types of higher priority go first, so the lower ones are deferred first. Returns true once the pass 
+    // is complete and the frame boundary is reached, events emitted to types already passed wait for the next pass
+    bool run_for(std::chrono::nanoseconds budget)
+    {
+      const auto deadline = clock_type::now() + budget;
+
+      auto& cursor = cursor_;
+
+      if (!cursor.active)
+      {
+        const auto& order = schedule().order;
+
+        budget_order_.assign(order.begin(), order.end());
+
+        std::stable_sort(budget_order_.begin(), budget_order_.end(), [](const event_data* lhs, const event_data* rhs) {
+          return lhs->priority > rhs->priority;
+        });
+
+        cursor = dispatch_cursor{};
+        cursor.active = true;
+      }
+
+      dispatching_ = true;
+
+      size_t calls = 0;
+
+      for (; cursor.order < budget_order_.size(); ++cursor.order, cursor.offset = 0, cursor.listener = 0, cursor.consumed = 0, cursor.size = 0, cursor.started = false)
+      {
+        auto* data = budget_order_[cursor.order];
+
+        if (!data)
+          continue;
+
+        if (!resume(*data, deadline, calls))
+        {
+          dispatching_ = false;
+          return false;
+        }
+
+        settle(*data);
+      }
+
+      dispatching_ = false;
+      cursor = dispatch_cursor{};
+
+      sync();
+      return true;
+    }
+
+    // the order run_for dispatches types in, higher first. Types of the same priority follow the pipeline
+    template<typename EventType>
+    self_type& set_priority(int32_t priority)
+    {
+      using event_type = EventType;
+
+      secure<event_type>().priority = priority;
+      return *this;
+    }
+
+    // like run(), but independent nodes of the same level of the pipeline run on the workers.
+    // Handlers running in parallel may only emit the types declared by emits, and not to the bus
+    void run_parallel()
+    {
+      assert(workers_ && "set_workers has to be called first");
+
+      dispatching_ = true;
+
+      const auto& plan = schedule();
+
+      for (size_t level = 0; level + 1 < plan.levels.size(); ++level)
+      {
+        const auto first = plan.levels[level];
+        const auto last  = plan.levels[level + 1];
+
+        level_jobs_.store(last - first, std::memory_order_relaxed);
+
+        // the caller takes the first job, so a level of one job doesn't leave the thread
+        for (auto job = first + 1; job < last; ++job)
+          workers_->submit(&dispatcher::process_job, (void*)&plan.jobs[job]);
+
+        process_job((void*)&plan.jobs[first]);
+
+        // only the jobs of the level, the pool may run worker listeners that have until the next frame
+        workers_->wait([this] { return !level_jobs_.load(std::memory_order_acquire); });
+
+        for (auto i = plan.jobs[first].begin; i < plan.jobs[last - 1].end; ++i)
+          settle(*plan.order[i]);
+      }
+
+      dispatching_ = false;
+
+      sync();
+    }
+
+    // memory for the members of events, e.g. frame_string{ name, events.frame_memory() }.
+    // It is reset at the frame boundary after the next one, so the events have to be dispatched by then.
+    // Only the thread calling run may allocate from it
+    std::pmr::memory_resource* frame_memory()
+    {
+      return frame_memory_.resource();
+    }
+
+    // records the dispatch spans into 'tracer', nullptr turns tracing off
+    self_type& set_tracer(tracer* tracer)
+    {
+      tracer_ = tracer;
+      return *this;
+    }
+
+    // the pool run_parallel runs on, the worker listeners run on it too from their next batch on.
+    // Without one, they get a pool the dispatcher makes on first use
+    self_type& set_workers(worker_pool& workers)
+    {
+      workers_ = &workers;
+      return *this;
+    }
+
+    // pipeline phases run in ascending order, types of the same phase are ordered by emits
+    template<typename EventType>
+    self_type& set_phase(uint32_t phase)
+    {
+      using event_type = EventType;
+
+      secure<event_type>().phase = phase;
+      replan_ = true;
+      return *this;
+    }
+
+    // declares that handlers of EventType may emit Emitted, so Emitted is dispatched 
+    // after EventType within the same frame unless it belongs to an earlier phase
+    template<typename EventType, typename Emitted>
+    self_type& emits()
+    {
+      using event_type   = EventType;
+      using emitted_type = Emitted;
+
+      secure<emitted_type>();
+
+      auto& targets = secure<event_type>().targets;
+      constexpr auto target = mq::meta<emitted_type>().hash;
+
+      if (std::find(targets.begin(), targets.end(), target) == targets.end())
+        targets.push_back(target);
+
+      replan_ = true;
+      return *this;
+    }
+
+    // the frame boundary, called by run(). Runs the main listeners of the batches detached since the
+    // previous one and joins the batches whose worker listeners had a whole frame to finish. 
+    // Registers the types listened to from other threads and frees the listener snapshots 
+    // and the frame memory handed out before the previous frame boundary
+    void sync()
+    {
+      auto detached = deferred();
+
+      // the workers are only waited for when they fell behind by a frame
+      if (!joining_.empty())
+      {
+        for (auto& batch : joining_)
+          batch->workers->wait([&batch] { return batch->done.load(std::memory_order_acquire); });
+
+        complete(joining_);
+      }
+
+      // the batches without worker listeners are done already
+      for (auto& batch : detached)
+      {
+        if (batch->offloaded.empty())
+          complete(batch);
+        else
+          joining_.push_back(std::move(batch));
+      }
+
+      std::vector<deferred_listen> pending;
+      {
+        std::lock_guard lock{registry_};
+        pending.swap(pending_);
+      }
+
+      for (auto& deferred : pending)
+      {
+        auto& data = (this->*deferred.secure)();
+
+        if (deferred.apply)
+        {
+          deferred.apply(*this, deferred);
+          continue;
+        }
+
+        std::lock_guard lock{registry_};
+        attach(data, deferred.delegate, deferred.policy);
+      }
+
+      retired_.reclaim();
+      frame_memory_.flip();
+    }
+
+    // waits for every listener running on the workers, including the ones of this frame, 
+    // runs the ones deferred to this thread and the final stage of every batch detached so far
+    void join()
+    {
+      auto detached = deferred();
+
+      for (auto& batch : detached)
+        joining_.push_back(std::move(batch));
+
+      if (joining_.empty())
+        return;
+
+      for (auto& batch : joining_)
+      {
+        if (batch->workers)
+          batch->workers->wait([&batch] { return batch->done.load(std::memory_order_acquire); });
+      }
+
+      complete(joining_);
+    }
+
+    // captures the pending events of every pool and of the bus, trivially copyable events are 
+    // copied a used range at a time. Taken between frames, detached batches are not captured.
+    // Frame scoped events are left out, copies would outlive the frame memory
+    frame_snapshot snapshot()
+    {
+      frame_snapshot state;
+      snapshot(state);
+
+      return state;
+    }
+
+    // captures into 'state' reusing its memory
+    void snapshot(frame_snapshot& state)
+    {
+      state.clear();
+
+      size_t total = 0;
+
+      for (auto& [type, data] : events_)
+      {
+        if (!data.frame_scoped)
+          total += frame_snapshot::align(data.pool.size());
+      }
+
+      auto measure = [&](byte* first, size_t size) { total += frame_snapshot::align(event_queue::phase_of(first) + size); };
+
+      for (const auto& lane : lanes_)
+        lane.queue.segments(measure);
+
+      spill_.segments(measure);
+
+      state.bytes_.reserve(total);
+
+      for (auto& [type, data] : events_)
+      {
+        auto& pool = data.pool;
+
+        if (pool.empty() || data.frame_scoped)
+          continue;
+
+        const size_t offset = state.allocate(pool.size());
+
+        copy(data, state.bytes_.get(offset), pool.data(), pool.size() / data.info.size);
+
+        state.pools_.push_back(frame_snapshot::image {
+          .type   = type,
+          .offset = offset,
+          .size   = pool.size()
+        });
+
+        if (data.destroy)
+          state.owned_.push_back({ offset, pool.size() / data.info.size, data.destroy });
+      }
+
+      state.bus_.resize(lanes_.size());
+
+      for (size_t lane = 0; lane < lanes_.size(); ++lane)
+        capture(lanes_[lane].queue, state.bus_[lane], state);
+
+      capture(spill_, state.spill_, state);
+
+      state.spilling_ = spilling_;
+    }
+
+    // replaces the pending events by the ones captured, the snapshot stays untouched.
+    // Pools of types registered after the capture and of frame scoped types are emptied
+    void restore(const frame_snapshot& state)
+    {
+      assert(!cursor_.active && "a run_for pass is pending");
+
+      for (auto& [type, data] : events_)
+      {
+        auto& pool = data.pool;
+
+        if (data.destroy)
+          data.destroy(pool.data(), pool.size() / data.info.size);
+
+        pool.reset();
+      }
+
+      for (const auto& image : state.pools_)
+      {
+        auto iter = events_.find(image.type);
+
+        if (iter == events_.end())
+          continue;
+
+        auto& data = iter->second;
+        auto& pool = data.pool;
+
+        if (image.size > pool.capacity())
+        {
+          reserved_ += image.size - pool.capacity();
+          pool.reserve(image.size);
+        }
+
+        copy(data, pool.data(), state.bytes_.get(image.offset), image.size / data.info.size);
+        pool.resize(image.size);
+      }
+
+      for (auto& lane : lanes_)
+        discard(lane.queue);
+
+      discard(spill_);
+
+      if (!state.spill_.segments.empty() && spill_.pages.empty())
+        spill_.create();
+
+      // the lanes removed since the capture end up in the last one
+      for (size_t lane = 0; lane < state.bus_.size(); ++lane)
+        replay(lanes_[std::min(lane, lanes_.size() - 1u)].queue, state.bus_[lane], state);
+
+      replay(spill_, state.spill_, state);
+
+      spilling_ = state.spilling_;
+    }
+
+    void run_bus()
+    {
+      trace_scope span{ tracer_, "run_bus", span_kind::bus };
+
+      draining_ = true;
+
+      drain_lanes(&bus_lane::queue);
+
+      for (auto& lane : lanes_)
+        lane.queue.reset();
+
+      if (spilling_)
+      {
+        drain(spill_);
+        spill_.release();
+        spilling_ = false;
+      }
+
+      draining_ = false;
+    }
+
+    // dispatches the bus until 'budget' is spent a whole event at a time, 
+    // the rest stays queued for the next call. Returns true once the bus is empty
+    bool run_bus_for(std::chrono::nanoseconds budget)
+    {
+      const auto deadline = clock_type::now() + budget;
+
+      trace_scope span{ tracer_, "run_bus_for", span_kind::bus };
+
+      draining_ = true;
+
+      bool done = drain_lanes(&bus_lane::queue, deadline);
+
+      if (done)
+      {
+        for (auto& lane : lanes_)
+          lane.queue.reset();
+
+        if (spilling_ && (done = drain(spill_, deadline)))
+        {
+          spill_.release();
+          spilling_ = false;
+        }
+      }
+
+      draining_ = false;
+      return done;
+    }
+
+    // from now on any thread may emit to the bus and run_bus_blocking dispatches it.
+    // Producers take a lock and wake the consumer when the bus stops being empty.
+    // Event types have to be registered before
+    void start_service()
+    {
+      for (auto& lane : lanes_)
+      {
+        if (lane.service.pages.empty())
+          lane.service.create();
+      }
+
+      stopping_.store(false, std::memory_order_relaxed);
+      service_.store(true, std::memory_order_release);
+    }
+
+    // makes run_bus_blocking return once the bus is drained, the bus stays in service mode
+    void stop_service()
+    {
+      stopping_.store(true, std::memory_order_release);
+      wake();
+    }
+
+    // the loop of a dedicated consumer thread, spins for 'spin' rounds when the bus runs dry 
+    // and then sleeps until a producer wakes it up
+    void run_bus_blocking(uint32_t spin = 4096)
+    {
+      assert(service_.load(std::memory_order_relaxed) && "start_service has to be called first");
+
+      while (true)
+      {
+        const uint32_t seen = signal_.load(std::memory_order_acquire);
+
+        if (serve())
+          continue;
+
+        if (stopping_.load(std::memory_order_acquire))
+          return;
+
+        for (uint32_t i = 0; i < spin && signal_.load(std::memory_order_relaxed) == seen; ++i)
+          cpu_relax();
+
+        if (signal_.load(std::memory_order_acquire) != seen)
+          continue;
+
+        parked_.store(true, std::memory_order_seq_cst);
+
+        if (signal_.load(std::memory_order_seq_cst) == seen)
+          signal_.wait(seen, std::memory_order_acquire);
+
+        parked_.store(false, std::memory_order_relaxed);
+      }
+    }
+    
+  private:
+    void copy(const event_data& data, void* dst, const void* src, size_t count)
+    {
+      if (data.copy)
+      {
+        data.copy(dst, src, count);
+        return;
+      }
+
+      assert(!data.pool.relocator() && "events that can't be copied can't be captured");
+
+      if (count)
+        std::memcpy(dst, src, count * data.info.size);
+    }
+
+    // calls function(data, offset) for every event of a run of slots, padding is skipped
+    template<typename Function>
+    void slots(const byte* first, size_t size, Function&& function)
+    {
+      for (size_t i = 0; i < size; )
+      {
+        const auto& header = *reinterpret_cast<const event_queue::slot_header*>(first + i);
+
+        if (header.type)
+          function(bus_data(header), i + event_queue::HEADER_SIZE);
+
+        i += size_t(header.stride) * event_queue::HEADER_SIZE;
+      }
+    }
+
+    // copies the pages of the bus slot by slot if any event isn't trivially copyable.
+    // A segment keeps its place relative to the alignment of the pages, frame scoped events become padding
+    void capture(const event_queue& queue, frame_snapshot::queue_image& image, frame_snapshot& state)
+    {
+      image.count = queue.pending();
+
+      queue.segments([&](byte* first, size_t size) {
+        const size_t phase = event_queue::phase_of(first);
+        const size_t offset = state.allocate(phase + size) + phase;
+        byte* dst = state.bytes_.get<byte>(offset);
+
+        std::memcpy(dst, first, size);
+
+        slots(first, size, [&](event_data& data, size_t event) {
+          if (data.frame_scoped)
+          {
+            auto& header = *reinterpret_cast<event_queue::slot_header*>(dst + event - event_queue::HEADER_SIZE);
+
+            header.type = 0;
+            --image.count;
+            return;
+          }
+
+          assert((data.copy || !data.pool.relocator()) && "events that can't be copied can't be captured");
+
+          if (data.copy)
+          {
+            data.copy(dst + event, first + event, 1u);
+
+            if (data.destroy)
+              state.owned_.push_back({ offset + event, 1u, data.destroy });
+          }
+        });
+
+        image.segments.push_back(frame_snapshot::image {
+          .type   = 0,
+          .offset = offset,
+          .size   = size,
+          .phase  = phase
+        });
+      });
+    }
+
+    void replay(event_queue& queue, const frame_snapshot::queue_image& image, const frame_snapshot& state)
+    {
+      for (const auto& segment : image.segments)
+      {
+        const byte* first = state.bytes_.get<byte>(segment.offset);
+        byte* dst = queue.acquire(segment.size, event_queue::PAGE_ALIGNMENT, segment.phase);
+
+        std::memcpy(dst, first, segment.size);
+
+        slots(first, segment.size, [&](event_data& data, size_t event) {
+          if (data.copy)
+            data.copy(dst + event, first + event, 1u);
+        });
+      }
+
+      queue.count += image.count;
+    }
+
+    // destroys the pending events of a bus queue and empties it
+    void discard(event_queue& queue)
+    {
+      if (queue.pages.empty())
+        return;
+
+      while (!queue.empty())
+      {
+        auto& data = bus_data(queue.check());
+
+        if (data.destroy)
+          data.destroy(const_cast<void*>(queue.peek()), 1u);
+
+        queue.pop();
+      }
+
+      queue.reset();
+    }
+
+    // the type of a bus event, looked up by its index instead of its hash
+    event_data& bus_data(const event_queue::slot_header& header)
+    {
+      auto* data = index_[header.type];
+
+      assert(data && "events of a cleared type are still on the bus");
+      return *data;
+    }
+
+    size_t lane_of(const event_data& data) const
+    {
+      return std::min<size_t>(data.lane == NO_LANE ? default_lane_ : data.lane, lanes_.size() - 1u);
+    }
+
+    size_t lanes_pending() const
+    {
+      size_t pending = 0;
+
+      for (const auto& lane : lanes_)
+        pending += lane.queue.pending();
+
+      return pending;
+    }
+
+    size_t lanes_used() const
+    {
+      size_t used = 0;
+
+      for (const auto& lane : lanes_)
+        used += lane.queue.used();
+
+      return used;
+    }
+
+    template<typename EventType, typename... Args>
+    bool push_bus(size_t lane, Args&&... args)
+    {
+      using event_type = EventType;
+
+      if (service_.load(std::memory_order_relaxed))
+        return post<event_type>(lane, std::forward<Args>(args)...);
+
+      event_queue* queue = admit_bus(event_queue::slot_size<event_type>(), lane);
+
+      if (!queue)
+        return false;
+
+      queue->push<event_type>(std::forward<Args>(args)...);
+      return true;
+    }
+
+    // a bus event in service mode, the consumer is only woken by the first event after it ran dry
+    template<typename EventType, typename... Args>
+    bool post(size_t lane, Args&&... args)
+    {
+      using event_type = EventType;
+
+      bool woken;
+      {
+        std::lock_guard lock{bus_lock_};
+
+        woken = !lanes_pending() && !spill_.pending();
+
+        event_queue* queue = admit_bus(event_queue::slot_size<event_type>(), lane);
+
+        if (!queue)
+          return false;
+
+        queue->push<event_type>(std::forward<Args>(args)...);
+      }
+
+      if (woken)
+        wake();
+
+      return true;
+    }
+
+    void wake()
+    {
+      signal_.fetch_add(1u, std::memory_order_seq_cst);
+
+      // a consumer that is still spinning sees the signal change
+      if (parked_.load(std::memory_order_seq_cst))
+        signal_.notify_one();
+    }
+
+    // takes what the producers queued so far and dispatches it outside of the lock
+    bool serve()
+    {
+      bool spilled;
+      {
+        std::lock_guard lock{bus_lock_};
+
+        if (!lanes_pending() && !spill_.pending())
+          return false;
+
+        for (auto& lane : lanes_)
+          lane.queue.swap(lane.service);
+
+        spilled = spilling_;
+
+        if (spilled)
+        {
+          spill_.swap(service_spill_);
+          spilling_ = false;
+        }
+      }
+
+      // the listener snapshots picked up from here on are kept alive across frame boundaries until leave
+      retired_.enter();
+
+      {
+        trace_scope span{ tracer_, "run_bus_blocking", span_kind::bus };
+
+        drain_lanes(&bus_lane::service);
+
+        for (auto& lane : lanes_)
+          lane.service.reset();
+
+        if (spilled)
+        {
+          drain(service_spill_);
+          service_spill_.release();
+        }
+      }
+
+      retired_.leave();
+      return true;
+    }
+
+    // checked before every handler call but the first, so each call makes some progress
+    static bool expired(clock_type::time_point deadline, size_t& calls)
+    {
+      return deadline != clock_type::time_point::max() && calls++ && clock_type::now() >= deadline;
+    }
+
+    // returns false if the deadline hit before the queue ran dry
+    bool drain(event_queue& queue, clock_type::time_point deadline = clock_type::time_point::max())
+    {
+      std::vector<std::unique_ptr<detached_batch>> detached;
+
+      bool done = true;
+      size_t calls = 0;
+
+      while (!queue.empty())
+      {
+        if (expired(deadline, calls))
+        {
+          done = false;
+          break;
+        }
+
+        dispatch(queue, detached);
+      }
+
+      for (auto& batch : detached)
+        launch(std::move(batch));
+
+      return done;
+    }
+
+    // dispatches the lanes until every one of them ran dry, events emitted to a lane meanwhile
+    // are dispatched too. Returns false if the deadline hit first
+    bool drain_lanes(event_queue bus_lane::* which, clock_type::time_point deadline = clock_type::time_point::max())
+    {
+      std::vector<std::unique_ptr<detached_batch>> detached;
+
+      bool done = true;
+      size_t calls = 0;
+
+      if (lane_order_ == lane_order::strict)
+      {
+        for (size_t lane = 0; lane < lanes_.size(); )
+        {
+          auto& queue = lanes_[lane].*which;
+
+          if (queue.empty())
+          {
+            ++lane;
+            continue;
+          }
+
+          if (expired(deadline, calls))
+          {
+            done = false;
+            break;
+          }
+
+          dispatch(queue, detached);
+
+          // a handler may have emitted to a lane of higher priority
+          lane = 0;
+        }
+      }
+      else
+      {
+        // stops once every lane was found empty in a row
+        for (size_t lane = 0, idle = 0; idle < lanes_.size(); lane = (lane + 1u) % lanes_.size())
+        {
+          auto& queue = lanes_[lane].*which;
+
+          if (queue.empty())
+          {
+            ++idle;
+            continue;
+          }
+
+          idle = 0;
+
+          for (uint32_t credit = lanes_[lane].weight; credit && !queue.empty() && done; --credit)
+          {
+            if (expired(deadline, calls))
+              done = false;
+            else
+              dispatch(queue, detached);
+          }
+
+          if (!done)
+            break;
+        }
+      }
+
+      for (auto& batch : detached)
+        launch(std::move(batch));
+
+      return done;
+    }
+
+    // the batches opened by a drain belong to it, so the service consumer and the frame never share one
+    void dispatch(event_queue& queue, std::vector<std::unique_ptr<detached_batch>>& detached)
+    {
+      auto& data = bus_data(queue.check());
+
+      const void* event = queue.peek();
+
+      auto handlers = data.listeners.snapshot();
+
+      auto size = handlers.size();
+      for (auto pos = size; pos; --pos)
+      {
+        auto& handler = handlers[pos - 1u];
+        handler(event);
+      }
+
+      // the events of a type are gathered into one batch for the listeners that don't run inline
+      if (!detaches(data))
+      {
+        finalize(data, const_cast<void*>(event), 1u);
+      }
+      else
+      {
+        auto batch = std::find_if(detached.begin(), detached.end(), [&data](const auto& open) { return open->data == &data; });
+
+        if (batch == detached.end())
+          batch = detached.emplace(detached.end());
+
+        detach(data, const_cast<void*>(event), data.info.size, *batch);
+      }
+
+      queue.pop();
+    }
+
+    // picks the queue for a new bus event of 'size' bytes according to the budget,
+    // once the bus spills everything goes to the overflow store until it's drained to keep the order
+    event_queue* admit_bus(size_t size, size_t lane)
+    {
+      if (spilling_)
+      {
+        ++bus_stats_.spilled;
+        return &spill_;
+      }
+
+      const auto& policy = bus_policy_;
+      auto& queue = lanes_[lane].queue;
+
+      if (!policy.byte_budget && !policy.event_budget)
+        return &queue;
+
+      auto fits = [&] {
+        return (!policy.byte_budget || lanes_used() + size <= policy.byte_budget) &&
+          (!policy.event_budget || lanes_pending() < policy.event_budget);
+      };
+
+      if (fits())
+        return &queue;
+
+      switch (policy.overflow)
+      {
+      case overflow_policy::drop_oldest:
+      {
+        // the page being dispatched can't be dropped
+        while (!draining_ && !fits())
+        {
+          if (!drop_bus_page())
+            break;
+        }
+
+        if (fits())
+          return &queue;
+
+        ++bus_stats_.dropped;
+      } return nullptr;
+      case overflow_policy::spill:
+      {
+        if (spill_.pages.empty())
+          spill_.create();
+
+        spilling_ = true;
+        ++bus_stats_.spilled;
+      } return &spill_;
+      case overflow_policy::drop_newest:
+        ++bus_stats_.dropped;
+        return nullptr;
+      default:
+        ++bus_stats_.rejected;
+        return nullptr;
+      }
+    }
+
+    // drops the oldest page of the lane with the lowest priority that has events
+    bool drop_bus_page()
+    {
+      for (auto lane = lanes_.size(); lane; --lane)
+      {
+        auto& queue = lanes_[lane - 1u].queue;
+
+        if (queue.empty())
+          continue;
+
+        auto dropped = queue.drop_page([this](uint16_t type, void* event) {
+          auto& data = *index_[type];
+
+          if (data.destroy)
+            data.destroy(event, 1u);
+        });
+
+        bus_stats_.dropped += dropped;
+        ++bus_stats_.dropped_pages;
+        return true;
+      }
+
+      return false;
+    }
+
+    template<typename EventType>
+    auto& secure()
+    {
+      using event_type = EventType;
+      constexpr auto type = mq::meta<event_type>().hash;
+
+      auto iter = events_.find(type);
+      if (iter == events_.end())
+      {
+        std::lock_guard lock{registry_};
+
+        auto& event_data = events_[type];
+        replan_ = true;
+        
+        event_data.info = event_info {
+          .name  = mq::meta<event_type>().name,
+          .type  = type,
+          .size  = sizeof(event_type),
+          .index = type_index<event_type>()
+        };
+
+        if (index_.size() <= event_data.info.index)
+          index_.resize(event_data.info.index + 1u, nullptr);
+
+        index_[event_data.info.index] = &event_data;
+
+        event_data.frame_scoped = is_frame_scoped_v<event_type>;
+
+        // frame scoped events only own frame memory, which is released at once
+        if constexpr (!std::is_trivially_destructible_v<event_type> && !is_frame_scoped_v<event_type>)
+        {
+          event_data.destroy = destructor<event_type>();
+        }
+
+        if constexpr (!std::is_trivially_copyable_v<event_type>)
+        {
+          event_data.pool.set_relocator(&arena::relocator<event_type>);
+
+          // copies of frame scoped events would outlive the frame memory
+          if constexpr (std::is_copy_constructible_v<event_type> && !is_frame_scoped_v<event_type>)
+            event_data.copy = copier<event_type>();
+        }
+        return event_data;
+      }
+      
+      return iter->second;
+    }
+    
+    // the registered type, without hashing
+    template<typename EventType>
+    event_data* find()
+    {
+      const auto index = type_index<EventType>();
+
+      return index < index_.size() ? index_[index] : nullptr;
+    }
+
+    // the registered type if anyone would see its events
+    template<typename EventType>
+    event_data* subscribed()
+    {
+      auto* data = find<EventType>();
+
+      return data && data->subscribed.load(std::memory_order_relaxed) ? data : nullptr;
+    }
+
+    void refresh(event_data& data)
+    {
+      const bool subscribed = !data.consumer.empty() || !data.viewers.empty() || 
+        !data.listeners.empty() || detaches(data);
+
+      data.subscribed.store(subscribed, std::memory_order_relaxed);
+    }
+
+    template<typename EventType>
+    auto destructor()
+    {
+      using event_type = EventType;
+      
+      return +[] (void* first, size_t count) {
+        std::destroy_n(static_cast<event_type*>(first), count);
+      };
+    }
+
+    template<typename EventType>
+    auto copier()
+    {
+      using event_type = EventType;
+
+      return +[] (void* dst, const void* src, size_t count) {
+        std::uninitialized_copy_n(static_cast<const event_type*>(src), count, static_cast<event_type*>(dst));
+      };
+    }
+
+    // picks the storage for a new event of 'size' bytes according to the budgets,
+    // nullptr means the event is dropped
+    arena* admit(event_data& data, size_t size)
+    {
+      auto& pool = data.pool;
+      const auto& policy = data.policy;
+
+      const size_t needed = pool.size() + size;
+
+      if (policy.budget && needed > policy.budget)
+        return overflow(data, size);
+
+      if (needed <= pool.capacity())
+        return &pool;
+
+      size_t ncapacity = std::max(pool.capacity() * 2, needed);
+
+      if (policy.budget)
+        ncapacity = std::min(ncapacity, policy.budget);
+
+      if (budget_ && reserved_ + ncapacity - pool.capacity() > budget_)
+      {
+        ncapacity = needed;
+
+        if (reserved_ + ncapacity - pool.capacity() > budget_)
+          return overflow(data, size);
+      }
+
+      reserved_ += ncapacity - pool.capacity();
+      pool.reserve(ncapacity);
+      return &pool;
+    }
+
+    arena* overflow(event_data& data, size_t size)
+    {
+      auto& pool = data.pool;
+      const auto& policy = data.policy;
+
+      switch (policy.overflow)
+      {
+      case overflow_policy::drop_oldest:
+      {
+        auto fits = [&] {
+          return pool.size() + size <= pool.capacity() && 
+            (!policy.budget || pool.size() + size <= policy.budget);
+        };
+
+        // the batch of a pass in progress can't be dropped, like the page the bus is draining,
+        // what's emitted to the type meanwhile is dropped instead
+        while (!data.dispatched && !pool.empty() && !fits())
+        {
+          if (data.destroy)
+            data.destroy(pool.data(), 1u);
+
+          pool.erase_front(size);
+          ++data.stats.dropped;
+        }
+
+        if (fits())
+          return &pool;
+      } break;
+      case overflow_policy::spill:
+      {
+        const size_t capacity = pool.capacity();
+
+        if (pool.size() + size > capacity)
+          pool.reserve(std::max(capacity * 2, pool.size() + size));
+
+        reserved_ += pool.capacity() - capacity;
+        ++data.stats.spilled;
+        data.spilled = true;
+      } return &pool;
+      case overflow_policy::reject:
+        ++data.stats.rejected;
+        return nullptr;
+      default:
+        break;
+      }
+
+      ++data.stats.dropped;
+      return nullptr;
+    }
+
+    // drops the dispatched events from the pool, the ones emitted to the type during its own pass
+    // are kept for the next. Hands the external segments back, 
+    // releases the memory spilled over the budgets and applies the high-water mark decay
+    void settle(event_data& data)
+    {
+      auto& pool = data.pool;
+      const auto& policy = data.policy;
+
+      release_external(data);
+
+      const size_t capacity = pool.capacity();
+
+      data.stats.peak = std::max(data.stats.peak, pool.size());
+
+      if (pool.size() > data.dispatched)
+        pool.erase_front(data.dispatched);
+      else
+        pool.reset();
+
+      data.dispatched = 0;
+
+      if (policy.budget && capacity > policy.budget)
+      {
+        pool.shrink(policy.budget);
+      }
+      else if (data.spilled)
+      {
+        // spilled past the global budget, the other types get the memory back
+        pool.shrink_to_fit();
+      }
+      else if (policy.decay_frames && ++data.frames >= policy.decay_frames)
+      {
+        pool.shrink(data.stats.peak);
+
+        data.stats.peak = 0;
+        data.frames = 0;
+      }
+
+      data.spilled = false;
+
+      const size_t released = capacity - pool.capacity();
+      reserved_ -= std::min(reserved_.load(), released);
+    }
+
+    static pool_stats collect(const event_data& data)
+    {
+      pool_stats stats = data.stats;
+
+      stats.reserved = data.pool.capacity();
+      stats.used     = data.pool.size();
+
+      return stats;
+    }
+
+    // the last stage of a batch, once every listener has seen it. The consumer moves the events out
+    // and the batch, moved from or not, is destroyed in one pass
+    void finalize(event_data& data, void* first, size_t count)
+    {
+      const auto consumer = data.consumer.snapshot();
+
+      if (!consumer.empty())
+      {
+        byte* event = static_cast<byte*>(first);
+
+        for (size_t i = 0; i < count; ++i, event += data.info.size)
+          consumer.front()(event);
+      }
+
+      if (data.destroy)
+        data.destroy(first, count);
+    }
+
+    // the first 'bytes' of a pool, read through the pool as the consumer may emit to the type and grow it.
+    // Moved from events are still alive, so they relocate like the others
+    void finalize(event_data& data, arena& pool, size_t bytes)
+    {
+      const auto consumer = data.consumer.snapshot();
+
+      if (!consumer.empty())
+      {
+        for (size_t i = 0; i < bytes; i += data.info.size)
+          consumer.front()(pool.get(i));
+      }
+
+      if (data.destroy)
+        data.destroy(pool.data(), bytes / data.info.size);
+    }
+
+    template<typename EventType, auto func>
+    auto wrap()
+    {
+      auto* wrapper = +[] (const void* event, void*, void*) mutable {
+        func(*static_cast<const EventType*>(event));
+      };
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = (void*)func,
+        .payload  = nullptr
+      };
+    }
+
+    template<typename EventType, auto func, typename Instance>
+    auto wrap(Instance* instance)
+    {
+      using callable_type = decltype(func);
+
+      if constexpr(std::is_member_function_pointer<callable_type>::value)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void* payload) {
+          ((Instance*)payload->*func)(*static_cast<const EventType*>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)wrapper,
+          .payload  = instance
+        };
+      }
+      else 
+      {
+        auto* wrapper = +[](const void* event, void* fn, void* payload) {
+          func((Instance*)payload, *static_cast<const EventType*>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)func,
+          .payload  = instance
+        };
+      }
+    }
+
+    template<typename EventType, typename Callable>
+    auto wrap(Callable callable)
+    {
+      using callable_type = Callable;
+      using event_type    = EventType;
+      
+      if constexpr(std::is_pointer_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void*) {
+          (*(callable_type)fn)(*static_cast<const event_type*>(event));
+        };
+        
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)callable,
+          .payload  = nullptr
+        };
+      }
+      else if constexpr(std::is_empty_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void*) {
+          callable_type{}(*static_cast<const event_type*>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)wrapper,
+          .payload  = nullptr
+        };
+      }
+    }
+    
+    template<typename EventType, typename Callable, typename Instance>
+    auto wrap(Callable callable, Instance* instance)
+    {
+      using callable_type = Callable;
+      using event_type    = EventType;
+
+      if constexpr (std::is_pointer_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void* payload) {
+          (*(callable_type)fn)((Instance*)payload, *static_cast<const event_type*>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)callable,
+          .payload  = instance
+        };
+      }
+      else if constexpr (std::is_empty_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void* payload) {
+          callable_type{}((Instance*)payload, *static_cast<const event_type*>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)wrapper,
+          .payload  = instance
+        };
+      }
+    }
+    
+    void trigger(event_data& data, const void* event)
+    {
+      for (const auto* list : { &data.listeners, &data.offloaded, &data.deferred })
+      {
+        auto handlers = list->snapshot();
+
+        for (auto i = handlers.size(); i; --i)
+          handlers[i - 1u](event);
+      }
+    }
+
+    template<typename EventType>
+    static batcher<EventType> batch(event_data& data)
+    {
+      return batcher<EventType>(data.pool);
+    }
+
+    template<typename EventType>
+    viewer<EventType> view(const event_data& data)
+    {
+      using event_type = EventType;
+
+      if (const auto* segment = data.viewing)
+        return viewer<event_type>((event_type*)segment->data, segment->size / sizeof(event_type));
+
+      auto& arena = data.pool;
+
+      auto size = arena.size() / sizeof(event_type);
+      return viewer<event_type>((event_type*)arena.data(), size);
+    }
+
+    // calls a function pointer or a stateless functor object
+    template<typename Callable, typename... Args>
+    static decltype(auto) invoke(void* fn, Args&&... args)
+    {
+      if constexpr (std::is_pointer_v<Callable>)
+        return (*(Callable)fn)(std::forward<Args>(args)...);
+      else
+        return Callable{}(std::forward<Args>(args)...);
+    }
+
+    template<typename EventType, auto func, auto pred>
+    auto wrap_if()
+    {
+      auto* wrapper = +[](const void* event, void*, void*) {
+        const auto& value = *static_cast<const EventType*>(event);
+
+        if (pred(value))
+          func(value);
+      };
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = (void*)wrapper,
+        .payload  = nullptr
+      };
+    }
+
+    template<typename EventType, auto func, auto pred, typename Instance>
+    auto wrap_if(Instance* instance)
+    {
+      auto* wrapper = +[](const void* event, void*, void* payload) {
+        const auto& value = *static_cast<const EventType*>(event);
+
+        if (!pred(value))
+          return;
+
+        if constexpr (std::is_member_function_pointer_v<decltype(func)>)
+          ((Instance*)payload->*func)(value);
+        else
+          func((Instance*)payload, value);
+      };
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = (void*)wrapper,
+        .payload  = instance
+      };
+    }
+
+    // the callable goes into function and the predicate into payload when they are pointers,
+    // the wrapper stands in for the ones that are stateless functor objects
+    template<typename EventType, typename Predicate, typename Callable>
+    auto wrap_if(Predicate pred, Callable callable)
+    {
+      auto* wrapper = +[](const void* event, void* fn, void* payload) {
+        const auto& value = *static_cast<const EventType*>(event);
+
+        if (invoke<Predicate>(payload, value))
+          invoke<Callable>(fn, value);
+      };
+
+      void* function = nullptr;
+      void* payload  = (void*)wrapper;
+
+      if constexpr (std::is_pointer_v<Callable>)
+        function = (void*)callable;
+      else
+        function = (void*)wrapper;
+
+      if constexpr (std::is_pointer_v<Predicate>)
+        payload = (void*)pred;
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = function,
+        .payload  = payload
+      };
+    }
+
+    // adds or removes a listener of the group filtering 'member', the group is a single listener
+    // of the type while it's not empty
+    template<typename EventType, auto member>
+    bool filter(const typename member_traits<decltype(member)>::value_type& value, const event_delegate& delegate, bool add)
+    {
+      using event_type = EventType;
+      using value_type = typename member_traits<decltype(member)>::value_type;
+      using group_type = field_group<value_type>;
+
+      static_assert(std::is_base_of_v<typename member_traits<decltype(member)>::class_type, event_type>,
+        "member has to be a field of EventType");
+
+      auto* wrapper = +[](const void* event, void*, void* payload) {
+        const auto& group = *static_cast<const group_type*>(payload);
+        const auto matching = group.matching(static_cast<const event_type*>(event)->*member);
+
+        for (auto pos = matching.size(); pos; --pos)
+          matching[pos - 1u].second(event);
+      };
+
+      // registers the filter once the type is, for a type first seen outside of the owner thread
+      auto* apply = +[](dispatcher& self, const deferred_listen& deferred) {
+        self.filter<event_type, member>(*static_cast<const value_type*>(deferred.value.get()), deferred.delegate, true);
+      };
+
+      if (add && owns())
+        secure<event_type>();
+
+      std::lock_guard lock{registry_};
+
+      // the filter may be waiting for the frame boundary
+      if (!add)
+      {
+        for (auto i = pending_.size(); i; i--)
+        {
+          const auto& deferred = pending_[i - 1u];
+
+          if (deferred.apply != apply || !(deferred.delegate == delegate))
+            continue;
+
+          const auto& waiting = *static_cast<const value_type*>(deferred.value.get());
+
+          if (!(waiting < value) && !(value < waiting))
+          {
+            pending_.erase(pending_.begin() + i - 1u);
+            return true;
+          }
+        }
+      }
+
+      auto registered = events_.find(mq::meta<event_type>().hash);
+
+      // like listen, a type the dispatcher hasn't seen waits for the frame boundary
+      if (registered == events_.end())
+      {
+        if (!add)
+          return false;
+
+        pending_.push_back(deferred_listen {
+          .secure   = &dispatcher::secure<event_type>,
+          .type     = mq::meta<event_type>().hash,
+          .delegate = delegate,
+          .policy   = execution_policy::immediate,
+          .value    = std::make_shared<value_type>(value),
+          .apply    = apply
+        });
+        return true;
+      }
+
+      auto* data = &registered->second;
+
+      auto iter = std::find_if(data->filters.begin(), data->filters.end(), [&](const field_filter& filter) {
+        return filter.key == (void*)wrapper;
+      });
+
+      if (iter == data->filters.end())
+      {
+        if (!add)
+          return false;
+
+        iter = data->filters.insert(iter, field_filter{ (void*)wrapper, std::make_shared<group_type>() });
+      }
+
+      auto* group = static_cast<group_type*>(iter->group.get());
+
+      const event_delegate shared {
+        .handler  = wrapper,
+        .function = (void*)wrapper,
+        .payload  = group
+      };
+
+      const bool was_empty = group->empty();
+
+      if (add)
+        group->push(value, delegate, retired_);
+      else if (!group->erase(value, delegate, retired_))
+        return false;
+
+      if (was_empty && !group->empty())
+        attach(*data, shared, execution_policy::immediate);
+      else if (!was_empty && group->empty())
+        revoke(*data, shared);
+
+      return true;
+    }
+
+    template<typename EventType>
+    static EventType&& take(const void* event)
+    {
+      return std::move(*static_cast<EventType*>(const_cast<void*>(event)));
+    }
+
+    template<typename EventType, auto func>
+    auto wrap_consume()
+    {
+      auto* wrapper = +[] (const void* event, void*, void*) {
+        func(take<EventType>(event));
+      };
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = (void*)func,
+        .payload  = nullptr
+      };
+    }
+
+    template<typename EventType, auto func, typename Instance>
+    auto wrap_consume(Instance* instance)
+    {
+      using callable_type = decltype(func);
+
+      auto* wrapper = +[](const void* event, void*, void* payload) {
+        if constexpr (std::is_member_function_pointer<callable_type>::value)
+          ((Instance*)payload->*func)(take<EventType>(event));
+        else
+          func((Instance*)payload, take<EventType>(event));
+      };
+
+      return event_delegate {
+        .handler  = wrapper,
+        .function = (void*)wrapper,
+        .payload  = instance
+      };
+    }
+
+    template<typename EventType, typename Callable>
+    auto wrap_consume(Callable callable)
+    {
+      using callable_type = Callable;
+      using event_type    = EventType;
+
+      if constexpr (std::is_pointer_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void* fn, void*) {
+          (*(callable_type)fn)(take<event_type>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)callable,
+          .payload  = nullptr
+        };
+      }
+      else if constexpr (std::is_empty_v<callable_type>)
+      {
+        auto* wrapper = +[](const void* event, void*, void*) {
+          callable_type{}(take<event_type>(event));
+        };
+
+        return event_delegate {
+          .handler  = wrapper,
+          .function = (void*)wrapper,
+          .payload  = nullptr
+        };
+      }
+    }
+
+    template<typename EventType, auto func>
+    auto wrap_view()
+    {
+      auto* wrapper = +[] (dispatcher* self, void*, void*) mutable {
+        func(self->view<EventType>());
+      };
+
+      return view_delegate {
+        .handler    = wrapper,
+        .dispatcher = this,
+        .function   = (void*)func,
+        .payload    = nullptr
+      };
+    }
+
+    // viewers, listeners and the final stage of a batch, the pool is settled by the caller
+    void process(event_data& data)
+    {
+      auto& pool = data.pool;
+      const auto handlers = data.listeners.snapshot();
+
+      if (!data.external.empty())
+        dispatch_external(data, handlers);
+
+      if (data.drain_state)
+        data.drain_state(*this, data);
+        
+      if (pool.empty())
+        return;
+
+      trace_scope span{ tracer_, data.info.name, span_kind::run };
+
+      for (auto& viewer : data.viewers)
+      {
+        trace_scope view_span{ tracer_, data.info.name, span_kind::viewer };
+        viewer();
+      }
+        
+      // the batch outlives the pass for the listeners that don't run inline
+      const bool detached = detaches(data);
+
+      // events the listeners emit to the type wait for the next pass
+      const size_t size = pool.size();
+      data.dispatched = size;
+
+      {
+        trace_scope listeners_span{ tracer_, data.info.name, span_kind::listeners };
+
+        for (size_t i = 0; i < size; i += data.info.size)
+        {
+          for (auto pos = handlers.size(); pos; --pos)
+          {
+            auto& handler = handlers[pos - 1u];
+            const void* event = pool.get(i);
+            handler(event);
+          }
+        }
+      }
+
+      // the consumer runs once every listener has seen the batch, a listener may still emit to the type
+      if (detached)
+      {
+        std::unique_ptr<detached_batch> batch;
+        detach(data, pool.data(), size, batch);
+        launch(std::move(batch));
+      }
+      else
+      {
+        finalize(data, pool, size);
+      }
+    }
+
+    // caller owned events are dispatched in place a segment at a time, 
+    // the listeners that don't run inline get a copy
+    void dispatch_external(event_data& data, std::span<const event_delegate> handlers)
+    {
+      trace_scope span{ tracer_, data.info.name, span_kind::run };
+
+      const bool detached = detaches(data);
+
+      std::unique_ptr<detached_batch> batch;
+
+      for (const auto& segment : data.external)
+      {
+        data.viewing = &segment;
+
+        for (auto& viewer : data.viewers)
+        {
+          trace_scope view_span{ tracer_, data.info.name, span_kind::viewer };
+          viewer();
+        }
+
+        data.viewing = nullptr;
+
+        {
+          trace_scope listeners_span{ tracer_, data.info.name, span_kind::listeners };
+
+          const byte* events = static_cast<const byte*>(segment.data);
+
+          for (auto pos = handlers.size(); pos; --pos)
+          {
+            auto& handler = handlers[pos - 1u];
+
+            for (size_t i = 0; i < segment.size; i += data.info.size)
+              handler(events + i);
+          }
+        }
+
+        if (detached)
+          detach(data, const_cast<void*>(segment.data), segment.size, batch);
+      }
+
+      // the copies are dropped without the consumer, like the events inline listeners see in place
+      if (batch)
+      {
+        batch->external = true;
+        launch(std::move(batch));
+      }
+    }
+
+    static void release_external(event_data& data)
+    {
+      for (const auto& segment : data.external)
+      {
+        if (segment.release)
+          segment.release(segment.context);
+      }
+
+      data.external.clear();
+    }
+
+    // dispatches a type event-major from the cursor on, returns false if the deadline hit first.
+    // The consumer runs once every listener has seen the batch, like in run
+    bool resume(event_data& data, clock_type::time_point deadline, size_t& calls)
+    {
+      auto& cursor = cursor_;
+      auto& pool = data.pool;
+
+      // the listeners and where they run are fixed for the whole type, so listen and unlisten 
+      // between two calls don't shift the listener the cursor points at
+      if (!cursor.started)
+      {
+        cursor.started = true;
+
+        const auto snapshot = data.listeners.snapshot();
+
+        cursor.listeners.assign(snapshot.begin(), snapshot.end());
+        cursor.detached = detaches(data);
+
+        const std::span<const event_delegate> handlers = cursor.listeners;
+
+        if (!data.external.empty())
+          dispatch_external(data, handlers);
+
+        if (data.drain_state)
+          data.drain_state(*this, data);
+
+        if (pool.empty())
+          return true;
+
+        for (auto& viewer : data.viewers)
+        {
+          trace_scope view_span{ tracer_, data.info.name, span_kind::viewer };
+          viewer();
+        }
+
+        // events the listeners emit to the type wait for the next pass, like in run
+        cursor.size = pool.size();
+        data.dispatched = cursor.size;
+      }
+
+      if (!cursor.size)
+        return true;
+
+      const std::span<const event_delegate> handlers = cursor.listeners;
+      const bool detached = cursor.detached;
+      const auto consumer = data.consumer.snapshot();
+      const bool consumes = !consumer.empty() && !detached;
+
+      trace_scope span{ tracer_, data.info.name, span_kind::listeners };
+
+      for (; cursor.offset < cursor.size; cursor.offset += data.info.size, cursor.listener = 0)
+      {
+        for (; cursor.listener < handlers.size(); ++cursor.listener)
+        {
+          if (expired(deadline, calls))
+            return false;
+
+          handlers[handlers.size() - 1u - cursor.listener](pool.get(cursor.offset));
+        }
+      }
+
+      // moved from events stay alive until the batch is destroyed
+      for (; consumes && cursor.consumed < cursor.size; cursor.consumed += data.info.size)
+      {
+        if (expired(deadline, calls))
+          return false;
+
+        consumer.front()(pool.get(cursor.consumed));
+      }
+
+      if (detached)
+      {
+        std::unique_ptr<detached_batch> batch;
+        detach(data, pool.data(), cursor.size, batch);
+        launch(std::move(batch));
+      }
+      else if (data.destroy)
+      {
+        data.destroy(pool.data(), cursor.size / data.info.size);
+      }
+
+      return true;
+    }
+
+    // takes the batches detached since the last call and runs their main listeners
+    std::vector<std::unique_ptr<detached_batch>> deferred()
+    {
+      std::vector<std::unique_ptr<detached_batch>> detached;
+      {
+        std::lock_guard lock{batches_};
+        detached.swap(detached_);
+      }
+
+      for (auto& batch : detached)
+      {
+        auto& data = *batch->data;
+        auto& pool = batch->pool;
+
+        if (batch->deferred.empty())
+          continue;
+
+        trace_scope span{ tracer_, data.info.name, span_kind::listeners };
+
+        for (auto pos = batch->deferred.size(); pos; --pos)
+        {
+          auto& handler = batch->deferred[pos - 1u];
+
+          for (size_t i = 0; i < pool.size(); i += data.info.size)
+            handler(pool.get(i));
+        }
+      }
+
+      return detached;
+    }
+
+    // the final stage of a batch every listener is done with, the batch is recycled
+    void complete(std::unique_ptr<detached_batch>& batch)
+    {
+      auto& pool = batch->pool;
+
+      // caller owned events are never consumed and trivially copyable, their copies are just dropped
+      if (!batch->external)
+        finalize(*batch->data, pool, pool.size());
+
+      pool.reset();
+
+      std::lock_guard lock{batches_};
+      spare_.push_back(std::move(batch));
+    }
+
+    void complete(std::vector<std::unique_ptr<detached_batch>>& batches)
+    {
+      for (auto& batch : batches)
+        complete(batch);
+
+      batches.clear();
+    }
+
+    static bool detaches(const event_data& data)
+    {
+      return !data.offloaded.empty() || !data.deferred.empty();
+    }
+
+    // moves 'bytes' worth of events into 'batch', opening it first. The batch stays with the caller 
+    // until it's launched. Batches are recycled across frames
+    void detach(event_data& data, void* first, size_t bytes, std::unique_ptr<detached_batch>& batch)
+    {
+      if (!batch)
+      {
+        {
+          std::lock_guard lock{batches_};
+
+          if (!spare_.empty())
+          {
+            batch = std::move(spare_.back());
+            spare_.pop_back();
+          }
+        }
+
+        if (!batch)
+          batch = std::make_unique<detached_batch>();
+
+        batch->self = this;
+        batch->data = &data;
+        batch->done.store(false, std::memory_order_relaxed);
+        batch->external = false;
+        batch->pool.set_relocator(data.pool.relocator());
+      }
+
+      batch->pool.relocate_back(first, bytes);
+    }
+
+    // hands the batch to the workers, the rest waits for join. The batch keeps a copy of the
+    // listeners, it may be joined after the snapshots it was launched with are reclaimed
+    void launch(std::unique_ptr<detached_batch> batch)
+    {
+      const auto& data = *batch->data;
+
+      const auto offloaded = data.offloaded.snapshot();
+      const auto deferred  = data.deferred.snapshot();
+
+      batch->offloaded.assign(offloaded.begin(), offloaded.end());
+      batch->deferred.assign(deferred.begin(), deferred.end());
+
+      std::lock_guard lock{batches_};
+
+      auto& launched = *detached_.emplace_back(std::move(batch));
+
+      launched.workers = nullptr;
+
+      if (launched.offloaded.empty())
+        return;
+
+      // the pool given to set_workers, the dispatcher only makes its own when there is none
+      if (workers_)
+      {
+        launched.workers = workers_;
       }
-      
-      return iter->second;
+      else
+      {
+        if (!offload_)
+          offload_ = std::make_unique<worker_pool>();
+
+        launched.workers = offload_.get();
+      }
+
+      launched.workers->submit(&dispatcher::offload_job, &launched);
     }
-    
-    template<typename EventType>
-    auto destructor()
+
+    static void offload_job(void* payload)
     {
-      using event_type = EventType;
-      
-      return +[] (const void* event, void*, void*) {
-        const event_type* e = static_cast<const event_type*>(event);
-        e->~event_type();
-      };
+      auto& batch = *static_cast<detached_batch*>(payload);
+      const auto& data = *batch.data;
+      const auto& pool = batch.pool;
+
+      {
+        trace_scope span{ batch.self->tracer_, data.info.name, span_kind::listeners };
+
+        for (auto pos = batch.offloaded.size(); pos; --pos)
+        {
+          auto& handler = batch.offloaded[pos - 1u];
+
+          for (size_t i = 0; i < pool.size(); i += data.info.size)
+            handler(pool.get(i));
+        }
+      }
+
+      // the batch may be recycled from here on
+      batch.done.store(true, std::memory_order_release);
     }
 
-    template<typename EventType, auto func>
-    auto wrap()
+    static void process_job(void* payload)
     {
-      auto* wrapper = +[] (const void* event, void*, void*) mutable {
-        func(*static_cast<const EventType*>(event));
-      };
+      const auto& job = *static_cast<const pipeline::job*>(payload);
 
-      return event_delegate {
-        .handler  = wrapper,
-        .function = func,
-        .payload  = nullptr
-      };
+      for (auto i = job.begin; i < job.end; ++i)
+        job.self->process(*job.self->plan_.order[i]);
+
+      job.self->level_jobs_.fetch_sub(1u, std::memory_order_release);
     }
 
-    template<typename EventType, auto func, typename Instance>
-    auto wrap(Instance* instance)
+    const pipeline& schedule()
     {
-      using callable_type = decltype(func);
+      if (replan_)
+        replan();
 
-      if constexpr(std::is_member_function_pointer<callable_type>::value)
-      {
-        auto* wrapper = +[](const void* event, void* fn, void* payload) {
-          ((Instance*)payload->*func)(*static_cast<const EventType*>(event));
-        };
+      return plan_;
+    }
 
-        return event_delegate {
-          .handler  = wrapper,
-          .function = wrapper,
-          .payload  = instance
-        };
+    // phases in ascending order, each one sorted topologically by the emits edges into levels.
+    // Types that emit to the same targets can't run in parallel, so they share a job
+    void replan()
+    {
+      auto& plan = plan_;
+
+      plan.order.clear();
+      plan.jobs.clear();
+      plan.levels.clear();
+
+      std::vector<event_data*> nodes;
+      nodes.reserve(events_.size());
+
+      for (auto& [type, data] : events_)
+        nodes.push_back(&data);
+
+      std::stable_sort(nodes.begin(), nodes.end(), [](const event_data* lhs, const event_data* rhs) {
+        return lhs->phase < rhs->phase;
+      });
+
+      std::unordered_map<const event_data*, uint32_t> indegree;
+
+      for (auto* node : nodes)
+        indegree[node];
+
+      auto same_phase_target = [&](const event_data* node, mq::shash_t type) -> event_data* {
+        auto iter = events_.find(type);
+
+        if (iter == events_.end() || iter->second.phase != node->phase)
+          return nullptr;
+
+        return &iter->second;
+      };
+
+      for (auto* node : nodes)
+      {
+        for (auto type : node->targets)
+        {
+          if (auto* target = same_phase_target(node, type); target && target != node)
+            ++indegree[target];
+        }
       }
-      else 
+
+      auto first = nodes.begin();
+
+      while (first != nodes.end())
       {
-        auto* wrapper = +[](const void* event, void* fn, void* payload) {
-          func((Instance*)payload, *static_cast<const EventType*>(event));
-        };
+        auto last = std::find_if(first, nodes.end(), [&](const event_data* node) {
+          return node->phase != (*first)->phase;
+        });
 
-        return event_delegate {
-          .handler  = wrapper,
-          .function = func,
-          .payload  = instance
-        };
+        std::vector<event_data*> level;
+
+        for (auto it = first; it != last; ++it)
+        {
+          if (!indegree[*it])
+            level.push_back(*it);
+        }
+
+        size_t scheduled = 0;
+
+        while (!level.empty())
+        {
+          add_level(level);
+          scheduled += level.size();
+
+          std::vector<event_data*> next;
+
+          for (auto* node : level)
+          {
+            for (auto type : node->targets)
+            {
+              auto* target = same_phase_target(node, type);
+
+              if (target && target != node && !--indegree[target])
+                next.push_back(target);
+            }
+          }
+
+          level.swap(next);
+        }
+
+        // cycles can't be ordered, their events emitted too late are dispatched next frame
+        if (scheduled != static_cast<size_t>(last - first))
+        {
+          for (auto it = first; it != last; ++it)
+          {
+            if (indegree[*it])
+            {
+              std::vector<event_data*> single{ *it };
+              add_level(single);
+            }
+          }
+        }
+
+        first = last;
       }
+
+      plan.levels.push_back(plan.jobs.size());
+      replan_ = false;
     }
 
-    template<typename EventType, typename Callable>
-    auto wrap(Callable callable)
+    void add_level(std::vector<event_data*>& level)
     {
-      using callable_type = Callable;
-      using event_type    = EventType;
-      
-      if constexpr(std::is_pointer_v<callable_type>)
+      auto& plan = plan_;
+
+      auto shares_target = [](const event_data* lhs, const event_data* rhs) {
+        for (auto type : lhs->targets)
+        {
+          if (std::find(rhs->targets.begin(), rhs->targets.end(), type) != rhs->targets.end())
+            return true;
+        }
+        return false;
+      };
+
+      plan.levels.push_back(plan.jobs.size());
+
+      // greedy grouping, every node joins the first job it conflicts with
+      std::vector<std::vector<event_data*>> groups;
+
+      for (auto* node : level)
       {
-        auto* wrapper = +[](const void* event, void* fn, void*) {
-          (*(callable_type)fn)(*static_cast<const event_type*>(event));
-        };
-        
-        return event_delegate {
-          .handler  = wrapper,
-          .function = callable,
-          .payload  = nullptr
-        };
+        std::vector<event_data*>* group = nullptr;
+
+        for (auto& candidate : groups)
+        {
+          for (auto* other : candidate)
+          {
+            if (shares_target(node, other))
+            {
+              group = &candidate;
+              break;
+            }
+          }
+
+          if (group)
+            break;
+        }
+
+        if (group)
+          group->push_back(node);
+        else
+          groups.push_back({ node });
       }
-      else if constexpr(std::is_empty_v<callable_type>)
+
+      for (auto& group : groups)
       {
-        auto* wrapper = +[](const void* event, void* fn, void*) {
-          callable_type{}(*static_cast<const event_type*>(event));
-        };
+        const auto begin = plan.order.size();
 
-        return event_delegate {
-          .handler  = wrapper,
-          .function = wrapper,
-          .payload  = nullptr
-        };
+        plan.order.insert(plan.order.end(), group.begin(), group.end());
+
+        plan.jobs.push_back(pipeline::job {
+          .self  = this,
+          .begin = begin,
+          .end   = plan.order.size()
+        });
       }
     }
-    
-    template<typename EventType, typename Callable, typename Instance>
-    auto wrap(Callable callable, Instance* instance)
+
+    // types are only registered on the dispatcher's own thread outside of run(),
+    // anything else is deferred to the next frame boundary
+    bool owns() const
     {
-      using callable_type = Callable;
-      using event_type    = EventType;
+      return std::this_thread::get_id() == owner_ && !dispatching_;
+    }
 
-      if constexpr (std::is_pointer_v<callable_type>)
+    static listener_list& list(event_data& data, execution_policy policy)
+    {
+      switch (policy)
       {
-        auto* wrapper = +[](const void* event, void* fn, void* payload) {
-          (*(callable_type)fn)((Instance*)payload, *static_cast<const event_type*>(event));
-        };
+      case execution_policy::worker: return data.offloaded;
+      case execution_policy::main:   return data.deferred;
+      default:                       return data.listeners;
+      }
+    }
 
-        return event_delegate {
-          .handler  = wrapper,
-          .function = callable,
-          .payload  = instance
-        };
+    // publishes a new listener snapshot, visible from the next pass on
+    template<typename EventType>
+    void subscribe(const event_delegate& delegate, execution_policy policy)
+    {
+      using event_type = EventType;
+
+      {
+        std::lock_guard lock{registry_};
+
+        auto iter = events_.find(mq::meta<event_type>().hash);
+
+        if (iter != events_.end())
+        {
+          attach(iter->second, delegate, policy);
+          return;
+        }
+
+        if (!owns())
+        {
+          pending_.push_back(deferred_listen {
+            .secure   = &dispatcher::secure<event_type>,
+            .type     = mq::meta<event_type>().hash,
+            .delegate = delegate,
+            .policy   = policy
+          });
+          return;
+        }
       }
-      else if constexpr (std::is_empty_v<callable_type>)
+
+      auto& data = secure<event_type>();
+
+      std::lock_guard lock{registry_};
+      attach(data, delegate, policy);
+    }
+
+    // takes a type out of the hierarchy, the types inheriting from it lose its listeners
+    void unlink(event_data& data)
+    {
+      for (auto* base : data.bases)
+        std::erase(base->derived, &data);
+
+      for (auto* derived : data.derived)
       {
-        auto* wrapper = +[](const void* event, void* fn, void* payload) {
-          callable_type{}((Instance*)payload, *static_cast<const event_type*>(event));
-        };
+        std::erase(derived->bases, &data);
 
-        return event_delegate {
-          .handler  = wrapper,
-          .function = wrapper,
-          .payload  = instance
-        };
+        for (auto* listeners : { &data.listeners, &data.offloaded, &data.deferred })
+        {
+          for (const auto& delegate : listeners->snapshot())
+            revoke(*derived, delegate);
+        }
       }
     }
-    
-    template<typename EventType, auto func>
-    auto wrap_view()
+
+    template<typename Derived, typename Base>
+    static size_t base_offset()
     {
-      auto* wrapper = +[] (dispatcher* self, void*, void*) mutable {
-        func(self->view<EventType>());
-      };
+      alignas(Derived) byte storage[sizeof(Derived)];
 
-      return view_delegate {
-        .handler    = wrapper,
-        .dispatcher = this,
-        .function   = func,
-        .payload    = nullptr
+      const auto* derived = reinterpret_cast<const Derived*>(storage);
+      return static_cast<size_t>(reinterpret_cast<const byte*>(static_cast<const Base*>(derived)) - storage);
+    }
+
+    // adds a listener to the type and to every type inheriting from it, the registry has to be locked
+    void attach(event_data& data, const event_delegate& delegate, execution_policy policy)
+    {
+      list(data, policy).push(delegate, retired_);
+      refresh(data);
+
+      for (auto* derived : data.derived)
+        attach(*derived, delegate, policy);
+    }
+
+    // removes a listener from the type and from every type inheriting from it, the registry has to be locked
+    bool revoke(event_data& data, const event_delegate& delegate)
+    {
+      const bool erased = data.listeners.erase(delegate, retired_) ||
+        data.offloaded.erase(delegate, retired_) || data.deferred.erase(delegate, retired_);
+
+      refresh(data);
+
+      for (auto* derived : data.derived)
+        revoke(*derived, delegate);
+
+      return erased;
+    }
+
+    // sets or removes the consumer of a type. It's published as a snapshot like the listeners, 
+    // and like listen a type the dispatcher hasn't seen waits for the frame boundary
+    template<typename EventType>
+    bool consume(const event_delegate& delegate, bool add)
+    {
+      using event_type = EventType;
+
+      // registers the consumer once the type is, for a type first seen outside of the owner thread
+      auto* apply = +[](dispatcher& self, const deferred_listen& deferred) {
+        self.consume<event_type>(deferred.delegate, true);
       };
+
+      if (add && owns())
+        secure<event_type>();
+
+      std::lock_guard lock{registry_};
+
+      // the consumer may be waiting for the frame boundary
+      const bool waiting = !add && std::erase_if(pending_, [apply](const deferred_listen& deferred) {
+        return deferred.apply == apply;
+      });
+
+      auto registered = events_.find(mq::meta<event_type>().hash);
+
+      if (registered == events_.end())
+      {
+        if (add)
+        {
+          pending_.push_back(deferred_listen {
+            .secure   = &dispatcher::secure<event_type>,
+            .type     = mq::meta<event_type>().hash,
+            .delegate = delegate,
+            .policy   = execution_policy::immediate,
+            .apply    = apply
+          });
+        }
+
+        return add || waiting;
+      }
+
+      auto& data = registered->second;
+
+      if (add)
+        data.consumer.assign(delegate, retired_);
+      else if (!data.consumer.clear(retired_))
+        return waiting;
+
+      refresh(data);
+      return true;
     }
 
-    bool try_erase_one(const event_delegate& delegate, mq::shash_t type)
+    bool unsubscribe(const event_delegate& delegate, mq::shash_t type)
     {
-      auto iter = events_.find(type);
+      std::lock_guard lock{registry_};
 
-      if (iter == events_.end())
-        return false;
+      auto iter = events_.find(type);
 
-      auto& handlers = iter->second.listeners;
+      if (iter != events_.end())
+      {
+        return revoke(iter->second, delegate);
+      }
 
-      for (auto i = handlers.size(); i; i--)
+      // the type may be waiting for the frame boundary
+      for (auto i = pending_.size(); i; i--)
       {
-        const auto& handler = handlers[i - 1u];
+        const auto& deferred = pending_[i - 1u];
 
-        if (delegate == handler)
+        if (deferred.type == type && deferred.delegate == delegate && !deferred.apply)
         {
-          handlers.erase(handlers.begin() + i - 1u);
+          pending_.erase(pending_.begin() + i - 1u);
           return true;
         }
       }
@@ -536,16 +3182,157 @@ namespace ges {
     }
 
   private:
+    // a field_group of a type, keyed by the wrapper of its shared listener
+    struct field_filter {
+      void* key;
+      std::shared_ptr<void> group;
+    };
+
+    // a sorted permutation of the events of a type, see view_sorted. The scratch of the sort is
+    // kept with it, types viewed on different workers in run_parallel don't share any
+    struct sort_cache {
+      const void* key = nullptr;
+      const void* base = nullptr;
+      uint64_t version = 0; // of the pool it was sorted from
+      std::vector<uint64_t> keys;
+      std::vector<uint32_t> order;
+      radix_sorter sorter;
+    };
+
     struct event_data {
+      using destroy_type = void(*)(void*, size_t);
+      using copy_type    = void(*)(void* dst, const void* src, size_t count);
+      using drain_type   = void(*)(dispatcher&, event_data&);
+
       event_info info;
       std::vector<view_delegate> viewers;
-      std::vector<event_delegate> listeners;
+      listener_list listeners;
+      std::vector<field_filter> filters;
+      std::vector<event_data*> bases;   // declared with inherit
+      std::vector<event_data*> derived;
+      std::vector<sort_cache> sorted;
+      listener_list offloaded; // execution_policy::worker
+      listener_list deferred;  // execution_policy::main
+      listener_list consumer;  // at most one, see listen_consume
+      destroy_type destroy = nullptr;
+      copy_type copy = nullptr;
+      bool frame_scoped = false; // see is_frame_scoped_v, not captured by snapshots
+      std::atomic<bool> subscribed = false;
       arena pool;
+      size_t dispatched = 0; // bytes of the pool taken by the pass in progress, until settled
+      bool spilled = false;  // past a budget since the last settle
+      pool_policy policy;
+      pool_stats stats;
+      uint32_t frames = 0;
+      uint32_t phase = 0;
+      uint32_t lane = NO_LANE;
+      int32_t priority = 0;
+      std::vector<mq::shash_t> targets;
+      std::vector<external_segment> external;
+      const external_segment* viewing = nullptr; // the segment seen by view() during dispatch
+      std::shared_ptr<void> state; // a state_channel, see set_state
+      drain_type drain_state = nullptr;
+    };
+
+    struct external_segment {
+      const void* data;
+      size_t size; // in bytes
+      release_type release;
+      void* context;
+    };
+
+    // events kept alive for the listeners that don't run inline
+    struct detached_batch {
+      dispatcher* self = nullptr;
+      event_data* data = nullptr;
+      arena pool;
+      listener_snapshot offloaded;
+      listener_snapshot deferred;
+      std::atomic<bool> done = false; // the worker listeners are
+      worker_pool* workers = nullptr; // the worker listeners run on
+      bool external = false; // copies of caller owned events, see submit_external
+    };
+
+    struct bus_lane {
+      event_queue queue;
+      event_queue service; // taken from queue by the service consumer
+      uint32_t weight = 1;
+    };
+
+    struct pipeline {
+      struct job {
+        dispatcher* self;
+        size_t begin;
+        size_t end;
+      };
+
+      std::vector<event_data*> order;
+      std::vector<job> jobs;     // ranges of order
+      std::vector<size_t> levels; // ranges of jobs
     };
     
+    // where run_for left off
+    struct dispatch_cursor {
+      bool active = false;
+      bool started = false;  // the viewers of the type ran
+      size_t order = 0;      // of the type in budget_order_
+      size_t offset = 0;     // in bytes of the next event
+      size_t listener = 0;   // listeners of the event already run
+      size_t consumed = 0;   // in bytes of the events the consumer took
+      size_t size = 0;       // in bytes of the batch, taken when the type starts
+      bool detached = false; // the type had worker or main listeners when it started
+      listener_snapshot listeners; // of the type, taken when it starts
+    };
+
+    struct deferred_listen {
+      event_data& (dispatcher::*secure)();
+      mq::shash_t type;
+      event_delegate delegate;
+      execution_policy policy;
+      std::shared_ptr<void> value = nullptr; // the value a listen_when waits for
+      void (*apply)(dispatcher&, const deferred_listen&) = nullptr; // registers a listen_when instead
+    };
+
     std::unordered_map<uint32_t, event_data> events_;
-    event_queue queue_;
+    std::vector<event_data*> index_;
+    std::thread::id owner_;
+    std::mutex registry_;
+    std::vector<deferred_listen> pending_;
+    reclaimer retired_;
+    bool dispatching_ = false;
+    pipeline plan_;
+    bool replan_ = false;
+    std::vector<event_data*> budget_order_;
+    dispatch_cursor cursor_;
+    worker_pool* workers_ = nullptr;
+    std::atomic<size_t> level_jobs_ = 0; // of run_parallel still running
+    tracer* tracer_ = nullptr;
+    frame_allocator frame_memory_;
+    std::vector<bus_lane> lanes_;
+    lane_order lane_order_ = lane_order::strict;
+    uint32_t default_lane_ = 0;
+    event_queue spill_;
+    bus_policy bus_policy_;
+    ges::bus_stats bus_stats_;
+    bool spilling_ = false;
+    bool draining_ = false;
+    size_t budget_ = 0;
+    std::atomic<size_t> reserved_ = 0;
+    std::mutex bus_lock_;
+    event_queue service_spill_;
+    std::atomic<bool> service_ = false;
+    std::atomic<bool> stopping_ = false;
+    std::atomic<bool> parked_ = false;
+    std::atomic<uint32_t> signal_ = 0;
+    std::mutex batches_;
+    std::vector<std::unique_ptr<detached_batch>> detached_;
+    std::vector<std::unique_ptr<detached_batch>> joining_; // launched before the last frame boundary
+    std::vector<std::unique_ptr<detached_batch>> spare_;
+    // declared last so it's destroyed first, its threads finish their jobs before the batches go away
+    std::unique_ptr<worker_pool> offload_;
   };
   
 
 }// namespace ges
+
+#include "channel.hpp"
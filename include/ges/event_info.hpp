@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <string_view>
 #include <cstdint>
 
@@ -8,6 +9,20 @@ namespace ges {
     std::string_view name;
     uint32_t type = 0;
     uint32_t size = 0;
+    uint32_t index = 0;
   };
 
+  namespace detail {
+    inline std::atomic<uint32_t> type_counter = 1;
+  }
+
+  // a dense index per event type, assigned on first use and shared by every dispatcher.
+  // 0 is never assigned
+  template<typename EventType>
+  uint32_t type_index()
+  {
+    static const uint32_t index = detail::type_counter.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
 } // namespace ges
@@ -1,98 +1,376 @@
 #pragma once
 #include "core.hpp"
-#include <metaq.hpp>
+#include "event_info.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 namespace ges {
-  
+
+  // a FIFO of type tagged events laid out in fixed size pages.
+  // Every event is preceded by a 4 byte header and placed at its own alignment
   class event_queue {
     friend class dispatcher;
   public:
+    // the header in front of every event. The stride covers the header, the event and the padding 
+    // that keeps the next event of the same type aligned, a type of 0 pads up to an over-aligned event
+    struct slot_header {
+      uint16_t type;   // type_index of the event
+      uint16_t stride; // in HEADER_SIZE units
+    };
+
     static constexpr auto PAGE_SIZE = 4096ULL * 256;
     static constexpr auto MAX_SIZE = PAGE_SIZE / 4ULL;
-    
+    static constexpr size_t HEADER_SIZE = sizeof(slot_header);
+    static constexpr size_t MAX_STRIDE = size_t(UINT16_MAX) * HEADER_SIZE;
+    static constexpr size_t PAGE_ALIGNMENT = 64;
+
+    template<typename EventType>
+    static constexpr size_t slot_alignment()
+    {
+      return std::max(alignof(EventType), HEADER_SIZE);
+    }
+
+    template<typename EventType>
+    static constexpr size_t slot_size()
+    {
+      constexpr size_t alignment = slot_alignment<EventType>();
+      return (HEADER_SIZE + sizeof(EventType) + alignment - 1) / alignment * alignment;
+    }
+
     template<typename EventType, typename... Args>
     void push(Args&&... args)
     {
-      static_assert(sizeof(EventType) <= MAX_SIZE);
       using event_type = EventType;
+      static_assert(sizeof(event_type) <= MAX_SIZE && slot_size<event_type>() <= MAX_STRIDE);
+      static_assert(alignof(event_type) <= PAGE_ALIGNMENT, "over-aligned past the alignment of the pages");
 
-      constexpr auto size = sizeof(event_type) + sizeof(mq::shash_t);
+      constexpr auto size = slot_size<event_type>();
+      constexpr auto alignment = slot_alignment<event_type>();
 
-      byte* slot = acquire(size);
+      byte* slot = acquire(size, alignment, alignment - HEADER_SIZE);
+
+      ::new(slot) slot_header(header<event_type>());
+
+      void* event = slot + HEADER_SIZE;
 
-      auto* type = ::new(slot) mq::shash_t(mq::meta<event_type>().hash);
-      
-      void* event = slot + sizeof(mq::shash_t);
-      
       ::new(event) event_type(std::forward<Args>(args)...);
+      ++count;
+    }
+
+    // acquires the slots for as many events as the current page can hold at once
+    template<typename EventType, typename Iterator>
+    void push_range(Iterator first, Iterator last)
+    {
+      using event_type = EventType;
+      static_assert(sizeof(event_type) <= MAX_SIZE && slot_size<event_type>() <= MAX_STRIDE);
+      static_assert(alignof(event_type) <= PAGE_ALIGNMENT, "over-aligned past the alignment of the pages");
+
+      constexpr auto size = slot_size<event_type>();
+      constexpr auto alignment = slot_alignment<event_type>();
+      constexpr auto phase = alignment - HEADER_SIZE;
+
+      const slot_header type = header<event_type>();
+
+      auto remaining = static_cast<size_t>(std::distance(first, last));
+
+      while(remaining)
+      {
+        const size_t used = pages[tail].size + padding(pages[tail].size, alignment, phase);
+        size_t n = std::min<size_t>(remaining, (PAGE_SIZE - std::min<size_t>(used, PAGE_SIZE)) / size);
+
+        if(!n)
+        {
+          next_page();
+          continue;
+        }
+
+        byte* slot = acquire(size * n, alignment, phase);
+
+        for(size_t i = 0; i < n; ++i, ++first, slot += size)
+        {
+          std::memcpy(slot, &type, HEADER_SIZE);
+
+          void* event = slot + HEADER_SIZE;
+
+          if constexpr (std::is_trivially_copyable_v<event_type>)
+          {
+            std::memcpy(event, std::addressof(*first), sizeof(event_type));
+          }
+          else
+          {
+            ::new(event) event_type(*first);
+          }
+        }
+
+        count += n;
+        remaining -= n;
+      }
+    }
+
+    void swap(event_queue& other) noexcept
+    {
+      std::swap(pages, other.pages);
+      std::swap(pointer, other.pointer);
+      std::swap(head, other.head);
+      std::swap(tail, other.tail);
+      std::swap(bytes, other.bytes);
+      std::swap(count, other.count);
     }
 
+    // bytes taken by pending events
+    size_t used() const { return bytes; }
+
+    // number of pending events
+    size_t pending() const { return count; }
+
+    // bytes allocated
+    size_t reserved() const { return pages.size() * PAGE_SIZE; }
+
   private:
-    const mq::shash_t& check()
+    struct page {
+      byte* data;
+      size_t size;
+    };
+
+    template<typename EventType>
+    static slot_header header()
+    {
+      const uint32_t index = type_index<EventType>();
+
+      assert(index <= UINT16_MAX && "too many event types for the bus");
+      return slot_header{ static_cast<uint16_t>(index), static_cast<uint16_t>(slot_size<EventType>() / HEADER_SIZE) };
+    }
+
+    // bytes to skip at 'offset' so that a slot starts 'phase' bytes past a multiple of 'alignment'
+    static size_t padding(size_t offset, size_t alignment, size_t phase)
     {
-      return *(mq::shash_t*)pointer;
+      return (phase + alignment - offset % alignment) % alignment;
+    }
+
+    // where a slot lies relative to the alignment of its page
+    static size_t phase_of(const byte* slot)
+    {
+      return static_cast<size_t>(reinterpret_cast<uintptr_t>(slot) % PAGE_ALIGNMENT);
+    }
+
+    const slot_header& check()
+    {
+      return *reinterpret_cast<const slot_header*>(pointer);
     }
 
     const void* peek()
     {
-      return pointer + sizeof(mq::shash_t);
+      return pointer + HEADER_SIZE;
     }
 
-    void pop(size_t offset)
+    // moves past the current slot, event or padding
+    void skip()
     {
-      pointer += sizeof(mq::shash_t) + offset;
+      const size_t stride = size_t(check().stride) * HEADER_SIZE;
+
+      pointer += stride;
+      bytes -= stride;
+    }
+
+    void pop()
+    {
+      skip();
+      --count;
     }
 
-    bool empty() const
+    // moves past any padding, so a queue that isn't empty is on an event
+    bool empty()
     {
-      return pointer >= pool + size;
+      for(;;)
+      {
+        while(pointer >= end(head) && head < tail)
+        {
+          pointer = pages[++head].data;
+        }
+
+        if(pointer >= end(head))
+          return true;
+
+        if(check().type)
+          return false;
+
+        skip();
+      }
     }
-    
-    void reset() 
-    { 
-      size = 0;
-      pointer = pool;
+
+    void reset()
+    {
+      for(auto& page : pages)
+      {
+        page.size = 0;
+      }
+
+      head = tail = 0;
+      pointer = pages.empty() ? nullptr : pages.front().data;
+      bytes = count = 0;
     }
 
     void create()
     {
-      pool = new byte[PAGE_SIZE];
-      pointer = pool;
-      size = 0;
+      pages.push_back(page{ allocate(), 0 });
+      pointer = pages.front().data;
+      head = tail = 0;
+      bytes = count = 0;
+    }
+
+    // calls function(byte* first, size_t size) for the pending slots of every page, oldest first
+    template<typename Function>
+    void segments(Function&& function) const
+    {
+      for(size_t index = head; index <= tail && index < pages.size(); ++index)
+      {
+        byte* first = index == head ? pointer : pages[index].data;
+
+        if(first < end(index))
+          function(first, static_cast<size_t>(end(index) - first));
+      }
+    }
+
+    // drops every pending event of the oldest page, destroy(type, event) is called for each of them
+    template<typename Function>
+    size_t drop_page(Function&& destroy)
+    {
+      size_t dropped = 0;
+
+      while(pointer < end(head))
+      {
+        if(!check().type)
+        {
+          skip();
+          continue;
+        }
+
+        destroy(check().type, const_cast<void*>(peek()));
+
+        pop();
+        ++dropped;
+      }
+
+      if(head == tail)
+      {
+        pages[head].size = 0;
+        pointer = pages[head].data;
+        return dropped;
+      }
+
+      // recycle the page at the back
+      page recycled = pages[head];
+      recycled.size = 0;
+
+      pages.erase(pages.begin() + head);
+      pages.push_back(recycled);
+
+      --tail;
+      pointer = pages[head].data;
+
+      return dropped;
+    }
+
+    // releases the pages past the first 'npages', the queue has to be empty
+    void shrink(size_t npages)
+    {
+      while(pages.size() > npages)
+      {
+        deallocate(pages.back().data);
+        pages.pop_back();
+      }
+
+      reset();
     }
-    
-    //void reserve();
 
     void release()
     {
-      if(pool)
-        delete pool;
-      
-      size = 0;
+      shrink(0);
     }
 
-    byte* acquire(size_t sz)
+    // 'sz' bytes starting 'phase' bytes past a multiple of 'alignment', 
+    // the bytes skipped to get there are marked as padding
+    byte* acquire(size_t sz, size_t alignment = HEADER_SIZE, size_t phase = 0)
     {
-      assert(sz + size < PAGE_SIZE);
+      assert(sz <= PAGE_SIZE);
+
+      size_t skipped = padding(pages[tail].size, alignment, phase);
+
+      if(pages[tail].size + skipped + sz > PAGE_SIZE)
+      {
+        next_page();
+        skipped = padding(0, alignment, phase);
+      }
+
+      auto& page = pages[tail];
+
+      if(skipped)
+        ::new(&page.data[page.size]) slot_header{ 0, static_cast<uint16_t>(skipped / HEADER_SIZE) };
+
+      byte* slot = &page.data[page.size + skipped];
+      page.size += skipped + sz;
+      bytes += skipped + sz;
 
-      byte* slot = &pool[size];
-      size += sz;
-      
       return slot;
     }
 
+    void next_page()
+    {
+      if(++tail == pages.size())
+      {
+        pages.push_back(page{ allocate(), 0 });
+      }
+    }
+
+    static byte* allocate()
+    {
+      return static_cast<byte*>(::operator new(PAGE_SIZE, std::align_val_t{ PAGE_ALIGNMENT }));
+    }
+
+    static void deallocate(byte* data)
+    {
+      ::operator delete(data, std::align_val_t{ PAGE_ALIGNMENT });
+    }
+
+    byte* end(size_t index) const
+    {
+      return pages[index].data + pages[index].size;
+    }
+
     event_queue() = default;
-    
+
+    event_queue(event_queue&& other) noexcept
+    {
+      swap(other);
+    }
+
+    event_queue& operator=(event_queue&& other) noexcept
+    {
+      swap(other);
+      return *this;
+    }
+
+    event_queue(const event_queue&) = delete;
+    event_queue& operator=(const event_queue&) = delete;
+
     ~event_queue()
     {
       release();
     }
 
   private:
-    byte* pool = nullptr;
+    std::vector<page> pages;
     byte* pointer = nullptr;
-    size_t size = 0;
-    size_t capacity = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t bytes = 0;
+    size_t count = 0;
   };
 
-} // namespace ges
\ No newline at end of file
+} // namespace ges
@@ -0,0 +1,155 @@
+#pragma once
+#include "core.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace ges {
+
+  // members of events allocated from the frame memory of a dispatcher, see dispatcher::frame_memory
+  using frame_string = std::pmr::string;
+
+  template<typename T>
+  using frame_vector = std::pmr::vector<T>;
+
+  // events whose members own nothing but frame memory, the dispatcher skips their destructors.
+  // They can't be captured by snapshots.
+  // Opt in per type: template<> inline constexpr bool ges::is_frame_scoped_v<ChatMessage> = true;
+  template<typename EventType>
+  inline constexpr bool is_frame_scoped_v = false;
+
+  // a bump allocator that is reset wholesale, deallocate does nothing. Not thread safe
+  class frame_resource : public std::pmr::memory_resource {
+  public:
+    static constexpr size_t DEFAULT_CHUNK = 64ULL * 1024;
+    static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+  public:
+    explicit frame_resource(size_t chunk = DEFAULT_CHUNK)
+      : chunk_{chunk}
+    {}
+
+    frame_resource(const frame_resource&) = delete;
+    frame_resource& operator=(const frame_resource&) = delete;
+
+    ~frame_resource()
+    {
+      release();
+    }
+
+    // forgets every allocation. A frame that needed more than one chunk
+    // leaves a single chunk behind that is big enough for all of them
+    void reset()
+    {
+      if(chunks_.size() > 1)
+      {
+        const size_t total = capacity_;
+
+        release();
+        grow(total);
+      }
+      else if(!chunks_.empty())
+      {
+        cursor_ = chunks_.front().data;
+      }
+    }
+
+    void release()
+    {
+      for(auto& chunk : chunks_)
+        ::operator delete(chunk.data, std::align_val_t{ ALIGNMENT });
+
+      chunks_.clear();
+      capacity_ = 0;
+      cursor_ = end_ = nullptr;
+    }
+
+    // bytes allocated
+    size_t capacity() const { return capacity_; }
+
+  protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+      byte* first = align(cursor_, alignment);
+
+      if(!cursor_ || first + bytes > end_)
+      {
+        grow(bytes + alignment);
+        first = align(cursor_, alignment);
+      }
+
+      cursor_ = first + bytes;
+      return first;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override
+    {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+      return this == &other;
+    }
+
+  private:
+    struct chunk {
+      byte* data;
+      size_t size;
+    };
+
+    static byte* align(byte* pointer, size_t alignment)
+    {
+      const auto address = reinterpret_cast<uintptr_t>(pointer);
+      return pointer + ((alignment - address % alignment) % alignment);
+    }
+
+    // chunks grow geometrically so that at least 'bytes' more fit
+    void grow(size_t bytes)
+    {
+      const size_t size = std::max({ chunk_, bytes, capacity_ });
+
+      auto* data = static_cast<byte*>(::operator new(size, std::align_val_t{ ALIGNMENT }));
+
+      chunks_.push_back(chunk{ data, size });
+      capacity_ += size;
+
+      cursor_ = data;
+      end_ = data + size;
+    }
+
+  private:
+    size_t chunk_;
+    size_t capacity_ = 0;
+    byte* cursor_ = nullptr;
+    byte* end_ = nullptr;
+    std::vector<chunk> chunks_;
+  };
+
+  // two frame resources used in turns, so memory handed out during a frame
+  // stays valid until the end of the next one
+  class frame_allocator {
+  public:
+    frame_allocator() = default;
+    frame_allocator(const frame_allocator&) = delete;
+    frame_allocator& operator=(const frame_allocator&) = delete;
+
+    std::pmr::memory_resource* resource() { return &buffers_[current_]; }
+
+    // called at a frame boundary, resets the memory handed out before the previous one
+    void flip()
+    {
+      current_ ^= 1u;
+      buffers_[current_].reset();
+    }
+
+    // bytes allocated by both buffers
+    size_t capacity() const { return buffers_[0].capacity() + buffers_[1].capacity(); }
+
+  private:
+    frame_resource buffers_[2];
+    uint32_t current_ = 0;
+  };
+
+} // namespace ges
@@ -0,0 +1,280 @@
+#pragma once
+#include "delegate.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ges {
+
+  using listener_snapshot = std::vector<event_delegate>;
+
+  // keeps replaced snapshots alive for a grace period of one frame,
+  // so a reader that picked up a snapshot before the swap can finish with it.
+  // A reader that isn't bound to the frames, like the bus service consumer, reports when it holds snapshots 
+  // with enter and leave, what was retired after it entered is kept until it leaves
+  class reclaimer {
+  public:
+    reclaimer() = default;
+    reclaimer(const reclaimer&) = delete;
+    reclaimer& operator=(const reclaimer&) = delete;
+
+    ~reclaimer()
+    {
+      free(grace_);
+      free(retired_);
+    }
+
+    template<typename Snapshot>
+    void retire(const Snapshot* snapshot)
+    {
+      if(!snapshot)
+        return;
+
+      auto* deleter = +[](const void* snapshot) {
+        delete static_cast<const Snapshot*>(snapshot);
+      };
+
+      std::lock_guard lock{mutex_};
+      retired_.push_back(retired{ snapshot, deleter, epoch_.load(std::memory_order_relaxed) });
+    }
+
+    // called at a frame boundary, frees what was retired before the previous one
+    // unless the reader may still hold it
+    void reclaim()
+    {
+      std::lock_guard lock{mutex_};
+
+      const uint64_t reader = reader_.load(std::memory_order_seq_cst);
+
+      auto kept = std::partition(grace_.begin(), grace_.end(), [reader](const retired& retired) { 
+        return retired.epoch >= reader; 
+      });
+
+      for(auto it = kept; it != grace_.end(); ++it)
+        it->deleter(it->snapshot);
+
+      grace_.erase(kept, grace_.end());
+      grace_.insert(grace_.end(), retired_.begin(), retired_.end());
+      retired_.clear();
+
+      epoch_.fetch_add(1u, std::memory_order_release);
+    }
+
+    // the reader is about to pick up snapshots, anything it may see is retired after this point
+    void enter()
+    {
+      reader_.store(epoch_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    }
+
+    // the reader doesn't hold any snapshot anymore
+    void leave()
+    {
+      reader_.store(IDLE, std::memory_order_release);
+    }
+
+  private:
+    static constexpr uint64_t IDLE = ~0ULL;
+
+    struct retired {
+      const void* snapshot;
+      void(*deleter)(const void*);
+      uint64_t epoch; // frame boundaries passed before it was retired
+    };
+
+    static void free(std::vector<retired>& snapshots)
+    {
+      for(auto& retired : snapshots)
+        retired.deleter(retired.snapshot);
+
+      snapshots.clear();
+    }
+
+  private:
+    std::mutex mutex_;
+    std::vector<retired> grace_;
+    std::vector<retired> retired_;
+    std::atomic<uint64_t> epoch_ = 0;
+    std::atomic<uint64_t> reader_ = IDLE; // the epoch the reader entered at
+  };
+
+  // listeners published as immutable snapshots. Readers never lock and the span they get
+  // stays valid while the list changes, writers copy the list and swap it atomically.
+  // Writers have to be serialized by the owner
+  class listener_list {
+  public:
+    listener_list() = default;
+    listener_list(const listener_list&) = delete;
+    listener_list& operator=(const listener_list&) = delete;
+
+    ~listener_list()
+    {
+      delete current_.load(std::memory_order_relaxed);
+    }
+
+    std::span<const event_delegate> snapshot() const
+    {
+      const auto* current = current_.load(std::memory_order_acquire);
+
+      if(!current)
+        return {};
+
+      return { current->data(), current->size() };
+    }
+
+    size_t size() const { return snapshot().size(); }
+
+    bool empty() const { return snapshot().empty(); }
+
+    void push(const event_delegate& delegate, reclaimer& retired)
+    {
+      const auto* current = current_.load(std::memory_order_relaxed);
+
+      auto* next = current ? new listener_snapshot(*current) : new listener_snapshot();
+      next->push_back(delegate);
+
+      publish(next, retired);
+    }
+
+    // erases the most recently added equal delegate
+    bool erase(const event_delegate& delegate, reclaimer& retired)
+    {
+      const auto* current = current_.load(std::memory_order_relaxed);
+
+      if(!current)
+        return false;
+
+      for(auto i = current->size(); i; i--)
+      {
+        if((*current)[i - 1u] == delegate)
+        {
+          auto* next = new listener_snapshot(*current);
+          next->erase(next->begin() + i - 1u);
+
+          publish(next, retired);
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // replaces every listener with 'delegate', e.g. the single consumer of a type
+    void assign(const event_delegate& delegate, reclaimer& retired)
+    {
+      publish(new listener_snapshot{ delegate }, retired);
+    }
+
+    // returns false if there was nothing to clear
+    bool clear(reclaimer& retired)
+    {
+      if(empty())
+        return false;
+
+      publish(nullptr, retired);
+      return true;
+    }
+
+  private:
+    void publish(const listener_snapshot* next, reclaimer& retired)
+    {
+      retired.retire(current_.exchange(next, std::memory_order_acq_rel));
+    }
+
+  private:
+    std::atomic<const listener_snapshot*> current_ = nullptr;
+  };
+
+  // listeners filtered on the value of a field, kept sorted by value and published 
+  // as immutable snapshots like listener_list. Values only need operator<
+  template<typename Value>
+  class field_group {
+  public:
+    using value_type = Value;
+    using entry = std::pair<value_type, event_delegate>;
+    using snapshot_type = std::vector<entry>;
+
+  public:
+    field_group() = default;
+    field_group(const field_group&) = delete;
+    field_group& operator=(const field_group&) = delete;
+
+    ~field_group()
+    {
+      delete current_.load(std::memory_order_relaxed);
+    }
+
+    // the listeners of 'value' in order of registration
+    std::span<const entry> matching(const value_type& value) const
+    {
+      const auto* current = current_.load(std::memory_order_acquire);
+
+      if(!current)
+        return {};
+
+      auto [first, last] = std::equal_range(current->begin(), current->end(), value, compare{});
+
+      return { std::to_address(first), static_cast<size_t>(last - first) };
+    }
+
+    bool empty() const
+    {
+      const auto* current = current_.load(std::memory_order_acquire);
+      return !current || current->empty();
+    }
+
+    void push(const value_type& value, const event_delegate& delegate, reclaimer& retired)
+    {
+      const auto* current = current_.load(std::memory_order_relaxed);
+
+      auto* next = current ? new snapshot_type(*current) : new snapshot_type();
+      next->emplace(std::upper_bound(next->begin(), next->end(), value, compare{}), value, delegate);
+
+      publish(next, retired);
+    }
+
+    // erases the most recently added equal delegate of 'value'
+    bool erase(const value_type& value, const event_delegate& delegate, reclaimer& retired)
+    {
+      const auto* current = current_.load(std::memory_order_relaxed);
+
+      if(!current)
+        return false;
+
+      auto [first, last] = std::equal_range(current->begin(), current->end(), value, compare{});
+
+      for(; last != first; --last)
+      {
+        if(std::prev(last)->second == delegate)
+        {
+          auto* next = new snapshot_type(*current);
+          next->erase(next->begin() + (std::prev(last) - current->begin()));
+
+          publish(next, retired);
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  private:
+    struct compare {
+      bool operator()(const entry& lhs, const value_type& rhs) const { return lhs.first < rhs; }
+      bool operator()(const value_type& lhs, const entry& rhs) const { return lhs < rhs.first; }
+    };
+
+    void publish(const snapshot_type* next, reclaimer& retired)
+    {
+      retired.retire(current_.exchange(next, std::memory_order_acq_rel));
+    }
+
+  private:
+    std::atomic<const snapshot_type*> current_ = nullptr;
+  };
+
+} // namespace ges
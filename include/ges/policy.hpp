@@ -0,0 +1,58 @@
+#pragma once
+#include "core.hpp"
+
+namespace ges {
+
+  // what happens to an event that doesn't fit the budget
+  enum class overflow_policy : uint8_t {
+    reject,      // the new event is refused, try_emit and try_emit_bus return false and count it as rejected
+    drop_newest, // the new event is dropped and counted as dropped, try_emit and try_emit_bus return false
+    drop_oldest, // the oldest pending events are dropped to make room, a page at a time on the bus
+    spill        // the event is stored anyway, the excess is released after dispatch
+  };
+
+  // where a listener runs
+  enum class execution_policy : uint8_t {
+    immediate, // on the thread dispatching the batch
+    worker,    // on the dispatcher's worker pool, joined at the next sync
+    main       // on the thread calling sync, after the frame is dispatched
+  };
+
+  // how run_bus picks the next lane
+  enum class lane_order : uint8_t {
+    strict,  // always the first lane that has events, lane 0 first
+    weighted // round-robin, a lane dispatches up to its weight in events per turn
+  };
+
+  struct pool_policy {
+    size_t budget = 0;          // in bytes of pending events, 0 is unbounded
+    uint32_t decay_frames = 0;  // shrink to the high-water mark every N frames, 0 never shrinks
+    overflow_policy overflow = overflow_policy::reject;
+  };
+
+  struct pool_stats {
+    size_t reserved = 0; // bytes allocated
+    size_t used = 0;     // bytes of pending events
+    size_t peak = 0;     // high-water mark of the current decay window
+    size_t rejected = 0;
+    size_t dropped = 0;
+    size_t spilled = 0;
+  };
+
+  struct bus_policy {
+    size_t byte_budget = 0;  // 0 is unbounded
+    size_t event_budget = 0; // 0 is unbounded
+    overflow_policy overflow = overflow_policy::reject;
+  };
+
+  struct bus_stats {
+    size_t reserved = 0;      // bytes allocated, the overflow store included
+    size_t used = 0;          // bytes of pending events
+    size_t pending = 0;
+    size_t rejected = 0;
+    size_t dropped = 0;
+    size_t dropped_pages = 0;
+    size_t spilled = 0;
+  };
+
+} // namespace ges
@@ -0,0 +1,425 @@
+#pragma once
+#include "core.hpp"
+#include <metaq.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ges {
+
+  // the layout shared by the writer and the readers of a shared memory bus
+  struct shm_layout {
+    static constexpr uint32_t MAGIC   = 0x67455331; // "gES1"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t ALIGNMENT = 16;
+
+    struct header {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t capacity;
+      alignas(64) std::atomic<uint64_t> head; // bytes ever written, slots start at head % capacity
+    };
+
+    // a slot is stamped with its position in the stream when it's complete,
+    // a type of 0 pads the ring up to its end. Readers may race the writer on any field,
+    // so every one of them is read and written through relaxed atomics
+    struct alignas(ALIGNMENT) slot {
+      std::atomic<uint64_t> sequence;
+      std::atomic<mq::shash_t> type;
+      std::atomic<uint32_t> size;
+    };
+
+    static constexpr size_t RING_OFFSET = (sizeof(header) + 63) / 64 * 64;
+    static constexpr uint64_t BUSY = ~0ULL;
+
+    static constexpr uint64_t stride(size_t size)
+    {
+      return (sizeof(slot) + size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    // the payload a word at a time, slots are padded to the alignment so the last word stays in the slot
+    static void store(byte* dst, const void* src, size_t size)
+    {
+      for(size_t i = 0; i < size; i += sizeof(uint64_t))
+      {
+        uint64_t word = 0;
+        std::memcpy(&word, static_cast<const byte*>(src) + i, std::min(size - i, sizeof(uint64_t)));
+
+        std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t*>(dst + i)).store(word, std::memory_order_relaxed);
+      }
+    }
+
+    // 'dst' is rounded up to whole words
+    static void load(void* dst, const byte* src, size_t size)
+    {
+      for(size_t i = 0; i < size; i += sizeof(uint64_t))
+      {
+        auto& word = *reinterpret_cast<uint64_t*>(const_cast<byte*>(src + i));
+
+        static_cast<uint64_t*>(dst)[i / sizeof(uint64_t)] = std::atomic_ref<uint64_t>(word).load(std::memory_order_relaxed);
+      }
+    }
+  };
+
+  static_assert(shm_layout::ALIGNMENT % sizeof(uint64_t) == 0 && sizeof(shm_layout::slot) % shm_layout::ALIGNMENT == 0);
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free, "the shared memory bus needs lock free 64 bit atomics");
+
+  // a single producer ring of trivially copyable events in POSIX shared memory.
+  // The producer never waits for readers, they detect being overrun instead
+  class shm_queue {
+  public:
+    shm_queue() = default;
+    shm_queue(const shm_queue&) = delete;
+    shm_queue& operator=(const shm_queue&) = delete;
+
+    ~shm_queue()
+    {
+      close();
+    }
+
+    // creates the segment, 'name' follows shm_open rules e.g. "/game-telemetry"
+    bool open(const char* name, size_t capacity)
+    {
+      close();
+
+      capacity = (capacity + shm_layout::ALIGNMENT - 1) / shm_layout::ALIGNMENT * shm_layout::ALIGNMENT;
+
+      int fd = ::shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+      if(fd < 0)
+        return false;
+
+      size_ = shm_layout::RING_OFFSET + capacity;
+
+      if(::ftruncate(fd, static_cast<off_t>(size_)) != 0)
+      {
+        ::close(fd);
+        ::shm_unlink(name);
+        return false;
+      }
+
+      void* memory = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+
+      if(memory == MAP_FAILED)
+      {
+        ::shm_unlink(name);
+        return false;
+      }
+
+      memory_ = static_cast<byte*>(memory);
+      name_ = name;
+
+      header_ = ::new(memory_) shm_layout::header{};
+      header_->magic    = shm_layout::MAGIC;
+      header_->version  = shm_layout::VERSION;
+      header_->capacity = capacity;
+      header_->head.store(0, std::memory_order_release);
+
+      head_ = 0;
+
+      return true;
+    }
+
+    // unmaps and unlinks the segment, attached readers keep their mapping
+    void close()
+    {
+      if(!memory_)
+        return;
+
+      ::munmap(memory_, size_);
+      ::shm_unlink(name_.c_str());
+
+      memory_ = nullptr;
+      header_ = nullptr;
+      name_.clear();
+    }
+
+    template<typename EventType, typename... Args>
+    void push(Args&&... args)
+    {
+      using event_type = EventType;
+
+      static_assert(std::is_trivially_copyable_v<event_type>, "only trivially copyable events can be shared between processes");
+      static_assert(alignof(event_type) <= shm_layout::ALIGNMENT);
+
+      const event_type event(std::forward<Args>(args)...);
+
+      publish(mq::meta<event_type>().hash, &event, sizeof(event_type));
+    }
+
+    void publish(mq::shash_t type, const void* event, uint32_t size)
+    {
+      assert(memory_ && type);
+
+      const uint64_t capacity = header_->capacity;
+      const uint64_t stride = shm_layout::stride(size);
+
+      assert(stride <= capacity);
+
+      uint64_t offset = head_ % capacity;
+
+      if(offset + stride > capacity)
+      {
+        auto* padding = slot(offset);
+
+        padding->sequence.store(shm_layout::BUSY, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        padding->type.store(0, std::memory_order_relaxed);
+        padding->size.store(0, std::memory_order_relaxed);
+        padding->sequence.store(head_, std::memory_order_release);
+
+        head_ += capacity - offset;
+        offset = 0;
+      }
+
+      auto* slot = this->slot(offset);
+
+      // readers that are still on this slot see it's being reused
+      slot->sequence.store(shm_layout::BUSY, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      slot->type.store(type, std::memory_order_relaxed);
+      slot->size.store(size, std::memory_order_relaxed);
+      shm_layout::store(reinterpret_cast<byte*>(slot + 1), event, size);
+
+      slot->sequence.store(head_, std::memory_order_release);
+
+      head_ += stride;
+      header_->head.store(head_, std::memory_order_release);
+    }
+
+    bool is_open() const { return memory_ != nullptr; }
+
+  private:
+    shm_layout::slot* slot(uint64_t offset)
+    {
+      return reinterpret_cast<shm_layout::slot*>(memory_ + shm_layout::RING_OFFSET + offset);
+    }
+
+  private:
+    byte* memory_ = nullptr;
+    shm_layout::header* header_ = nullptr;
+    size_t size_ = 0;
+    uint64_t head_ = 0;
+    std::string name_;
+  };
+
+  // attaches to a shm_queue from another process with a read-only mapping. The writer never waits, so it may
+  // reuse a slot while it's being read: poll copies each event out of the ring and only hands out copies
+  // the writer didn't touch, peek reads in place and leaves the check to the caller with validate.
+  // A reader that falls a whole ring behind skips to the head
+  class shm_reader {
+  public:
+    shm_reader() = default;
+    shm_reader(const shm_reader&) = delete;
+    shm_reader& operator=(const shm_reader&) = delete;
+
+    ~shm_reader()
+    {
+      detach();
+    }
+
+    // starts reading from the events published after attaching
+    bool attach(const char* name)
+    {
+      detach();
+
+      int fd = ::shm_open(name, O_RDONLY, 0);
+      if(fd < 0)
+        return false;
+
+      struct stat info;
+      if(::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < shm_layout::RING_OFFSET)
+      {
+        ::close(fd);
+        return false;
+      }
+
+      size_ = static_cast<size_t>(info.st_size);
+
+      void* memory = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+
+      if(memory == MAP_FAILED)
+        return false;
+
+      memory_ = static_cast<const byte*>(memory);
+      header_ = reinterpret_cast<const shm_layout::header*>(memory_);
+
+      if(header_->magic != shm_layout::MAGIC || header_->version != shm_layout::VERSION ||
+        shm_layout::RING_OFFSET + header_->capacity > size_)
+      {
+        detach();
+        return false;
+      }
+
+      cursor_ = header_->head.load(std::memory_order_acquire);
+      return true;
+    }
+
+    void detach()
+    {
+      if(!memory_)
+        return;
+
+      ::munmap(const_cast<byte*>(memory_), size_);
+
+      memory_ = nullptr;
+      header_ = nullptr;
+    }
+
+    // an event in the ring, see peek
+    struct event_view {
+      mq::shash_t type = 0;
+      const void* data = nullptr;
+      uint32_t size = 0;
+      uint64_t position = 0; // in the stream, what the slot is stamped with while the event is intact
+    };
+
+    // the next event in place, without copying it. Returns false if there is none.
+    // The writer may overwrite it at any time, so whatever is read from it is only trusted 
+    // once validate still holds afterwards. pop moves on to the next one
+    bool peek(event_view& event)
+    {
+      const uint64_t capacity = header_->capacity;
+      const uint64_t head = header_->head.load(std::memory_order_acquire);
+
+      while(cursor_ < head)
+      {
+        if(head - cursor_ > capacity)
+        {
+          overrun(head);
+          return false;
+        }
+
+        const uint64_t offset = cursor_ % capacity;
+        const auto* slot = this->slot(offset);
+
+        if(slot->sequence.load(std::memory_order_acquire) != cursor_)
+        {
+          overrun(header_->head.load(std::memory_order_acquire));
+          return false;
+        }
+
+        // a size torn by the writer is clamped so the event stays in the ring
+        event.type = slot->type.load(std::memory_order_relaxed);
+        event.size = static_cast<uint32_t>(std::min<uint64_t>(slot->size.load(std::memory_order_relaxed), 
+          capacity - offset - sizeof(shm_layout::slot)));
+        event.data = slot + 1;
+        event.position = cursor_;
+
+        if(event.type)
+          return true;
+
+        if(!validate(event))
+        {
+          overrun(header_->head.load(std::memory_order_acquire));
+          return false;
+        }
+
+        cursor_ += capacity - offset;
+      }
+
+      return false;
+    }
+
+    // whether the writer left the event alone up to now, the slot is stamped busy before it's touched
+    bool validate(const event_view& event) const
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      return slot(event.position % header_->capacity)->sequence.load(std::memory_order_relaxed) == event.position;
+    }
+
+    // moves past the event returned by the last peek
+    void pop(const event_view& event)
+    {
+      cursor_ = event.position + shm_layout::stride(event.size);
+    }
+
+    // calls function(mq::shash_t type, const void* event, uint32_t size) for up to 'max' events.
+    // The event is a copy valid until the callback returns, only copies the writer didn't touch are handed out.
+    // Returns the number of events consumed
+    template<typename Function>
+    size_t poll(Function&& function, size_t max = ~size_t(0))
+    {
+      size_t consumed = 0;
+      event_view event;
+
+      while(consumed < max && peek(event))
+      {
+        if(buffer_.size() * sizeof(block) < event.size)
+          buffer_.resize((event.size + sizeof(block) - 1) / sizeof(block));
+
+        shm_layout::load(buffer_.data(), static_cast<const byte*>(event.data), event.size);
+
+        // the next peek finds the slot reused and skips to the head
+        if(!validate(event))
+          continue;
+
+        function(event.type, static_cast<const void*>(buffer_.data()), event.size);
+
+        pop(event);
+        ++consumed;
+      }
+
+      return consumed;
+    }
+
+    template<typename EventType>
+    static const EventType* cast(mq::shash_t type, const void* event)
+    {
+      return type == mq::meta<EventType>().hash ? static_cast<const EventType*>(event) : nullptr;
+    }
+
+    // how many times the reader was lapped by the writer
+    size_t overruns() const { return overruns_; }
+
+    // bytes of the stream skipped because of overruns
+    uint64_t lost() const { return lost_; }
+
+    bool is_attached() const { return memory_ != nullptr; }
+
+  private:
+    void overrun(uint64_t head)
+    {
+      ++overruns_;
+      lost_ += head - cursor_;
+      cursor_ = head;
+    }
+
+    const shm_layout::slot* slot(uint64_t offset) const
+    {
+      return reinterpret_cast<const shm_layout::slot*>(memory_ + shm_layout::RING_OFFSET + offset);
+    }
+
+  private:
+    struct alignas(shm_layout::ALIGNMENT) block {
+      byte bytes[shm_layout::ALIGNMENT];
+    };
+
+  private:
+    const byte* memory_ = nullptr;
+    const shm_layout::header* header_ = nullptr;
+    size_t size_ = 0;
+    std::vector<block> buffer_; // the event handed to the callback
+    uint64_t cursor_ = 0;
+    size_t overruns_ = 0;
+    uint64_t lost_ = 0;
+  };
+
+} // namespace ges
+
+#endif // defined(__unix__) || defined(__APPLE__)
@@ -0,0 +1,124 @@
+#pragma once
+#include "core.hpp"
+#include "arena.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace ges {
+
+  // the pending events of a dispatcher, see dispatcher::snapshot and dispatcher::restore.
+  // Only the used bytes are captured, a snapshot can be restored any number of times
+  // and reused by the next capture without reallocating
+  class frame_snapshot {
+    friend class dispatcher;
+  public:
+    frame_snapshot() = default;
+
+    frame_snapshot(const frame_snapshot&) = delete;
+    frame_snapshot& operator=(const frame_snapshot&) = delete;
+
+    frame_snapshot(frame_snapshot&& other) noexcept
+      : bytes_{std::move(other.bytes_)}, pools_{std::move(other.pools_)}, bus_{std::move(other.bus_)},
+        spill_{std::move(other.spill_)}, owned_{std::move(other.owned_)}, spilling_{other.spilling_}
+    {
+      other.owned_.clear();
+    }
+
+    frame_snapshot& operator=(frame_snapshot&& other) noexcept
+    {
+      if(this == &other)
+        return *this;
+
+      clear();
+
+      bytes_    = std::move(other.bytes_);
+      pools_    = std::move(other.pools_);
+      bus_      = std::move(other.bus_);
+      spill_    = std::move(other.spill_);
+      owned_    = std::move(other.owned_);
+      spilling_ = other.spilling_;
+
+      other.owned_.clear();
+      return *this;
+    }
+
+    ~frame_snapshot()
+    {
+      clear();
+    }
+
+    // destroys the captured events, the memory is kept for the next capture
+    void clear()
+    {
+      for(const auto& owned : owned_)
+        owned.destroy(bytes_.get(owned.offset), owned.count);
+
+      owned_.clear();
+      pools_.clear();
+      spill_.clear();
+
+      for(auto& lane : bus_)
+        lane.clear();
+
+      bytes_.reset();
+      spilling_ = false;
+    }
+
+    // bytes of captured events
+    size_t size() const { return bytes_.size(); }
+
+    bool empty() const { return bytes_.empty(); }
+
+  private:
+    static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+    static constexpr size_t align(size_t size)
+    {
+      return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    // a used range of a pool, or of a page of the bus
+    struct image {
+      uint32_t type;
+      size_t offset;
+      size_t size;
+      size_t phase = 0; // of a bus range relative to the alignment of the pages
+    };
+
+    struct queue_image {
+      std::vector<image> segments;
+      size_t count = 0;
+
+      void clear()
+      {
+        segments.clear();
+        count = 0;
+      }
+    };
+
+    // events that have to be destroyed with the snapshot
+    struct owned {
+      size_t offset;
+      size_t count;
+      void(*destroy)(void*, size_t);
+    };
+
+    // hands out the room for 'size' bytes, the buffer is reserved up front so it never moves
+    size_t allocate(size_t size)
+    {
+      const size_t offset = bytes_.size();
+
+      bytes_.resize(offset + align(size));
+      return offset;
+    }
+
+  private:
+    arena bytes_;
+    std::vector<image> pools_;
+    std::vector<queue_image> bus_; // a lane each
+    queue_image spill_;
+    std::vector<owned> owned_;
+    bool spilling_ = false;
+  };
+
+} // namespace ges
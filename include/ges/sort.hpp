@@ -0,0 +1,136 @@
+#pragma once
+#include "core.hpp"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace ges {
+
+  // maps a key to an unsigned integer of the same order, keys are at most 8 bytes
+  template<typename Key>
+  uint64_t radix_key(Key key)
+  {
+    static_assert(sizeof(Key) <= sizeof(uint64_t), "keys wider than 8 bytes can't be radix sorted");
+
+    if constexpr (std::is_enum_v<Key>)
+    {
+      return radix_key(static_cast<std::underlying_type_t<Key>>(key));
+    }
+    else if constexpr (std::is_same_v<Key, bool>)
+    {
+      return key ? 1u : 0u;
+    }
+    else if constexpr (std::is_floating_point_v<Key>)
+    {
+      using bits_type = std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+      static_assert(sizeof(Key) == sizeof(bits_type));
+
+      bits_type bits;
+      std::memcpy(&bits, &key, sizeof(Key));
+
+      // negative numbers have every bit flipped, positive ones only the sign
+      constexpr bits_type sign = bits_type(1) << (sizeof(Key) * 8 - 1);
+      return (bits & sign) ? bits_type(~bits) : bits_type(bits | sign);
+    }
+    else if constexpr (std::is_signed_v<Key>)
+    {
+      using unsigned_type = std::make_unsigned_t<Key>;
+      constexpr unsigned_type sign = unsigned_type(1) << (sizeof(Key) * 8 - 1);
+
+      return static_cast<unsigned_type>(key) ^ sign;
+    }
+    else
+    {
+      static_assert(std::is_unsigned_v<Key>, "keys have to be integers, floating point numbers or enums");
+      return key;
+    }
+  }
+
+  // a stable LSD radix sort of an index permutation, a byte per pass. Only the low 'width' bytes of the
+  // keys are sorted on and passes where every key shares the same byte are skipped
+  class radix_sorter {
+  public:
+    static constexpr size_t SMALL = 64; // sorted by insertion below
+
+  public:
+    // sorts [0, keys.size()) by keys into 'order', 'keys' ends up sorted as well
+    void sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& order, size_t width)
+    {
+      const size_t size = keys.size();
+
+      order.resize(size);
+
+      for (size_t i = 0; i < size; ++i)
+        order[i] = static_cast<uint32_t>(i);
+
+      if (size < SMALL)
+      {
+        insertion(keys, order);
+        return;
+      }
+
+      keys_.resize(size);
+      order_.resize(size);
+
+      for (size_t pass = 0; pass < width; ++pass)
+      {
+        const size_t shift = pass * 8;
+
+        size_t counts[256] = {};
+
+        for (size_t i = 0; i < size; ++i)
+          ++counts[(keys[i] >> shift) & 0xFF];
+
+        if (counts[(keys[0] >> shift) & 0xFF] == size)
+          continue;
+
+        size_t offset = 0;
+
+        for (auto& count : counts)
+        {
+          const size_t next = offset + count;
+          count = offset;
+          offset = next;
+        }
+
+        for (size_t i = 0; i < size; ++i)
+        {
+          const size_t slot = counts[(keys[i] >> shift) & 0xFF]++;
+
+          keys_[slot] = keys[i];
+          order_[slot] = order[i];
+        }
+
+        keys.swap(keys_);
+        order.swap(order_);
+      }
+    }
+
+  private:
+    static void insertion(std::vector<uint64_t>& keys, std::vector<uint32_t>& order)
+    {
+      for (size_t i = 1; i < keys.size(); ++i)
+      {
+        const uint64_t key = keys[i];
+        const uint32_t index = order[i];
+
+        size_t j = i;
+
+        for (; j && keys[j - 1u] > key; --j)
+        {
+          keys[j] = keys[j - 1u];
+          order[j] = order[j - 1u];
+        }
+
+        keys[j] = key;
+        order[j] = index;
+      }
+    }
+
+  private:
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> order_;
+  };
+
+} // namespace ges
@@ -0,0 +1,176 @@
+#pragma once
+#include "core.hpp"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace ges {
+
+  // the latest value of a state behind a seqlock, writers on any thread take turns on the sequence
+  // and readers never lock, they retry while a write is in flight. The value is kept in atomic words
+  // so a torn read is never a data race
+  template<typename StateType>
+  class alignas(64) state_slot {
+  public:
+    using state_type = StateType;
+
+    static_assert(std::is_trivially_copyable_v<state_type>, "states are copied by the bytes");
+    static_assert(std::is_default_constructible_v<state_type>);
+
+  public:
+    // returns false if the value didn't change
+    bool store(const state_type& value)
+    {
+      uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+
+      // an odd sequence is a write in flight
+      while ((sequence & 1u) || !sequence_.compare_exchange_weak(sequence, sequence + 1u, std::memory_order_acquire))
+      {
+        cpu_relax();
+        sequence = sequence_.load(std::memory_order_relaxed);
+      }
+
+      std::atomic_thread_fence(std::memory_order_release);
+
+      uint64_t next[WORDS] = {};
+      std::memcpy(next, &value, sizeof(state_type));
+
+      bool changed = !sequence;
+
+      for (size_t i = 0; i < WORDS; ++i)
+        changed |= words_[i].load(std::memory_order_relaxed) != next[i];
+
+      if (!changed)
+      {
+        sequence_.store(sequence, std::memory_order_release);
+        return false;
+      }
+
+      for (size_t i = 0; i < WORDS; ++i)
+        words_[i].store(next[i], std::memory_order_relaxed);
+
+      sequence_.store(sequence + 2u, std::memory_order_release);
+      changed_.store(true, std::memory_order_release);
+      return true;
+    }
+
+    state_type load() const
+    {
+      uint64_t words[WORDS];
+
+      for (;;)
+      {
+        const uint32_t sequence = sequence_.load(std::memory_order_acquire);
+
+        if (sequence & 1u)
+        {
+          cpu_relax();
+          continue;
+        }
+
+        for (size_t i = 0; i < WORDS; ++i)
+          words[i] = words_[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence_.load(std::memory_order_relaxed) == sequence)
+          break;
+      }
+
+      state_type value;
+      std::memcpy(&value, words, sizeof(state_type));
+      return value;
+    }
+
+    // how many times the value changed
+    uint32_t version() const { return sequence_.load(std::memory_order_acquire) / 2u; }
+
+    // clears the changed flag, returns whether it was set
+    bool take_changed() { return changed_.exchange(false, std::memory_order_acq_rel); }
+
+  private:
+    static constexpr size_t WORDS = (sizeof(state_type) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  private:
+    std::atomic<uint32_t> sequence_ = 0;
+    std::atomic<bool> changed_ = false;
+    std::atomic<uint64_t> words_[WORDS] = {};
+  };
+
+  // what the listeners of a keyed state see, the key that changed with its value.
+  // Listened to like any event, triggered along with StateType by set_state
+  template<typename StateType>
+  struct state_update {
+    size_t key;
+    StateType value;
+  };
+
+  // a slot per key for a state type, see dispatcher::set_state. Keys are dense indices
+  // e.g. of players or connections, the slots are allocated once so readers can keep a reference
+  template<typename StateType>
+  class state_channel {
+  public:
+    using state_type = StateType;
+
+  public:
+    explicit state_channel(size_t slots)
+      : slots_{std::make_unique<state_slot<state_type>[]>(slots)}, size_{slots}
+    { }
+
+    state_channel(const state_channel&) = delete;
+    state_channel& operator=(const state_channel&) = delete;
+
+    // returns false if the value didn't change, the listeners only see changes
+    bool publish(size_t key, const state_type& value)
+    {
+      assert(key < size_ && "no slot for the key");
+
+      if (!slots_[key].store(value))
+        return false;
+
+      changed_.store(true, std::memory_order_release);
+      return true;
+    }
+
+    bool publish(const state_type& value)
+    {
+      return publish(0u, value);
+    }
+
+    // the latest value, from any thread
+    state_type get(size_t key = 0) const
+    {
+      assert(key < size_ && "no slot for the key");
+      return slots_[key].load();
+    }
+
+    uint32_t version(size_t key = 0) const
+    {
+      assert(key < size_ && "no slot for the key");
+      return slots_[key].version();
+    }
+
+    size_t size() const { return size_; }
+
+    // calls function(key, value) for every slot that changed since the last call
+    template<typename Function>
+    void drain(Function&& function)
+    {
+      if (!changed_.exchange(false, std::memory_order_acq_rel))
+        return;
+
+      for (size_t key = 0; key < size_; ++key)
+      {
+        if (slots_[key].take_changed())
+          function(key, slots_[key].load());
+      }
+    }
+
+  private:
+    std::unique_ptr<state_slot<state_type>[]> slots_;
+    size_t size_;
+    std::atomic<bool> changed_ = false;
+  };
+
+} // namespace ges
@@ -0,0 +1,217 @@
+#pragma once
+#include "core.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ges {
+
+  enum class span_kind : uint8_t {
+    run,       // a type being dispatched by run
+    viewer,    // a single viewer callback
+    listeners, // every listener over a batch
+    bus        // a run_bus drain
+  };
+
+  struct trace_span {
+    std::string_view name;
+    uint64_t begin;
+    uint64_t end;
+    span_kind kind;
+  };
+
+  // records dispatch spans into a ring buffer per thread, a thread only ever writes to its own ring.
+  // The spans can be dumped as Chrome trace-event JSON which Perfetto and chrome://tracing load
+  class tracer {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 1ULL << 16;
+
+  public:
+    // 'capacity' spans per thread, rounded up to a power of two
+    explicit tracer(size_t capacity = DEFAULT_CAPACITY)
+      : id_{next_id()}
+    {
+      capacity_ = 1;
+      while(capacity_ < capacity)
+        capacity_ <<= 1;
+    }
+
+    tracer(const tracer&) = delete;
+    tracer& operator=(const tracer&) = delete;
+
+    static uint64_t now()
+    {
+      using namespace std::chrono;
+      return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    void record(std::string_view name, span_kind kind, uint64_t begin, uint64_t end)
+    {
+      ring& local = this->local();
+
+      const uint64_t head = local.head.load(std::memory_order_relaxed);
+
+      local.spans[head & (capacity_ - 1)] = trace_span{ name, begin, end, kind };
+      local.head.store(head + 1, std::memory_order_release);
+    }
+
+    // writes the spans still held by the rings, the oldest ones are overwritten once a ring is full.
+    // The rings are read without stopping their threads, so it's called while nothing records e.g. between frames
+    void dump(std::ostream& out) const
+    {
+      std::lock_guard lock{mutex_};
+
+      out << "{\"traceEvents\":[";
+
+      bool first = true;
+
+      for(const auto& ring : rings_)
+      {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t count = head < capacity_ ? head : capacity_;
+
+        for(uint64_t i = head - count; i < head; ++i)
+        {
+          const auto& span = ring->spans[i & (capacity_ - 1)];
+
+          out << (first ? "" : ",") << "{\"name\":\"";
+          escape(out, span.name);
+          out << "\",\"cat\":\"" << category(span.kind) << "\",\"ph\":\"X\""
+            << ",\"ts\":" << span.begin / 1000 << '.' << pad(span.begin % 1000)
+            << ",\"dur\":" << (span.end - span.begin) / 1000 << '.' << pad((span.end - span.begin) % 1000)
+            << ",\"pid\":1,\"tid\":" << ring->thread << '}';
+
+          first = false;
+        }
+      }
+
+      out << "]}";
+    }
+
+    // like dump, only while nothing records
+    void clear()
+    {
+      std::lock_guard lock{mutex_};
+
+      for(auto& ring : rings_)
+        ring->head.store(0, std::memory_order_release);
+    }
+
+  private:
+    struct ring {
+      std::unique_ptr<trace_span[]> spans;
+      std::atomic<uint64_t> head = 0;
+      uint32_t thread = 0;
+      std::thread::id owner;
+    };
+
+    // each thread caches the ring of the last tracer it recorded to,
+    // a thread switching between tracers finds its ring again instead of making a new one
+    ring& local()
+    {
+      struct cache {
+        uint64_t owner = 0;
+        ring* local = nullptr;
+      };
+
+      thread_local cache cached;
+
+      if(cached.owner == id_)
+        return *cached.local;
+
+      const auto thread = std::this_thread::get_id();
+
+      std::lock_guard lock{mutex_};
+
+      auto it = std::find_if(rings_.begin(), rings_.end(), [thread](const auto& ring) { return ring->owner == thread; });
+
+      if(it == rings_.end())
+      {
+        auto& created = rings_.emplace_back(std::make_unique<ring>());
+        created->spans = std::make_unique<trace_span[]>(capacity_);
+        created->thread = static_cast<uint32_t>(rings_.size());
+        created->owner = thread;
+
+        it = rings_.end() - 1;
+      }
+
+      cached = cache{ id_, it->get() };
+      return **it;
+    }
+
+    static uint64_t next_id()
+    {
+      static std::atomic<uint64_t> counter = 0;
+      return ++counter;
+    }
+
+    static const char* category(span_kind kind)
+    {
+      switch(kind)
+      {
+      case span_kind::run:       return "run";
+      case span_kind::viewer:    return "viewer";
+      case span_kind::listeners: return "listeners";
+      case span_kind::bus:       return "bus";
+      }
+      return "";
+    }
+
+    struct pad {
+      uint64_t value;
+      friend std::ostream& operator<<(std::ostream& out, pad p)
+      {
+        return out << (p.value < 100 ? "0" : "") << (p.value < 10 ? "0" : "") << p.value;
+      }
+    };
+
+    static void escape(std::ostream& out, std::string_view name)
+    {
+      for(char c : name)
+      {
+        if(c == '"' || c == '\\')
+          out << '\\';
+        out << c;
+      }
+    }
+
+  private:
+    const uint64_t id_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ring>> rings_;
+  };
+
+  // records a span on scope exit, does nothing without a tracer
+  class trace_scope {
+  public:
+    trace_scope(tracer* target, std::string_view name, span_kind kind)
+      : tracer_{target}, name_{name}, kind_{kind}
+    {
+      if(tracer_)
+        begin_ = tracer::now();
+    }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+    ~trace_scope()
+    {
+      if(tracer_)
+        tracer_->record(name_, kind_, begin_, tracer::now());
+    }
+
+  private:
+    tracer* tracer_;
+    std::string_view name_;
+    span_kind kind_;
+    uint64_t begin_ = 0;
+  };
+
+} // namespace ges
@@ -1,4 +1,8 @@
 #pragma once
+#include "core.hpp"
+#include <compare>
+#include <cstddef>
+#include <iterator>
 
 namespace ges {
 
@@ -46,6 +50,162 @@ namespace ges {
     size_type size_   = 0ull;
   };
 
+  // the events of a type in the order of a key, see dispatcher::view_sorted.
+  // The events stay where they are, the viewer walks a sorted permutation of them
+  template<typename EventType, auto member>
+  class sorted_viewer {
+    friend class dispatcher;
+  public:
+    using event_type = EventType;
+    using value_type = EventType;
+    using key_type   = typename member_traits<decltype(member)>::value_type;
+    using size_type  = size_t;
+
+    class iterator {
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type        = EventType;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const event_type*;
+      using reference         = const event_type&;
+
+      iterator() = default;
+
+      reference operator*() const { return base_[*order_]; }
+      pointer operator->() const { return base_ + *order_; }
+      reference operator[](difference_type n) const { return base_[order_[n]]; }
+
+      iterator& operator++() { ++order_; return *this; }
+      iterator operator++(int) { auto copy = *this; ++order_; return copy; }
+      iterator& operator--() { --order_; return *this; }
+      iterator operator--(int) { auto copy = *this; --order_; return copy; }
+
+      iterator& operator+=(difference_type n) { order_ += n; return *this; }
+      iterator& operator-=(difference_type n) { order_ -= n; return *this; }
+
+      friend iterator operator+(iterator it, difference_type n) { return it += n; }
+      friend iterator operator+(difference_type n, iterator it) { return it += n; }
+      friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+      friend difference_type operator-(const iterator& lhs, const iterator& rhs) { return lhs.order_ - rhs.order_; }
+
+      friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.order_ == rhs.order_; }
+      friend auto operator<=>(const iterator& lhs, const iterator& rhs) { return lhs.order_ <=> rhs.order_; }
+
+    private:
+      friend class sorted_viewer;
+
+      iterator(const event_type* base, const uint32_t* order)
+        : base_{base}, order_{order}
+      { }
+
+    private:
+      const event_type* base_ = nullptr;
+      const uint32_t* order_ = nullptr;
+    };
+
+    using const_iterator = iterator;
+
+    // a run of events sharing the same key
+    struct group {
+      iterator first;
+      iterator last;
+
+      const key_type& key() const { return (*first).*member; }
+
+      iterator begin() const { return first; }
+      iterator end() const { return last; }
+
+      size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    // yields the runs of equal keys in ascending order
+    class group_range {
+    public:
+      class iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = group;
+        using difference_type   = std::ptrdiff_t;
+
+        iterator() = default;
+
+        group operator*() const { return group{ view_->begin() + first_, view_->begin() + last_ }; }
+
+        iterator& operator++()
+        {
+          first_ = last_;
+          last_ = view_->run_end(first_);
+          return *this;
+        }
+
+        iterator operator++(int) { auto copy = *this; ++*this; return copy; }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.first_ == rhs.first_; }
+
+      private:
+        friend class group_range;
+
+        iterator(const sorted_viewer* view, size_t first)
+          : view_{view}, first_{first}, last_{view->run_end(first)}
+        { }
+
+      private:
+        const sorted_viewer* view_ = nullptr;
+        size_t first_ = 0;
+        size_t last_ = 0;
+      };
+
+      iterator begin() const { return iterator(&view_, 0); }
+      iterator end() const { return iterator(&view_, view_.size()); }
+
+    private:
+      friend class sorted_viewer;
+
+      explicit group_range(const sorted_viewer& view)
+        : view_{view}
+      { }
+
+    private:
+      sorted_viewer view_;
+    };
+
+  public:
+    iterator begin() const { return iterator(base_, order_); }
+    iterator end() const { return iterator(base_, order_ + size_); }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t size() const { return size_; }
+
+    const event_type& at(size_t index) const { return base_[order_[index]]; }
+
+    group_range group_by() const { return group_range(*this); }
+
+  private:
+    sorted_viewer(const event_type* base, const uint32_t* order, const uint64_t* keys, size_type size)
+      : base_{base}, order_{order}, keys_{keys}, size_{size}
+    { }
+
+    sorted_viewer() = default;
+
+    // the end of the run of equal keys starting at 'first'
+    size_t run_end(size_t first) const
+    {
+      size_t last = first;
+
+      while (last < size_ && keys_[last] == keys_[first])
+        ++last;
+
+      return last;
+    }
+
+  private:
+    const event_type* base_ = nullptr;
+    const uint32_t* order_ = nullptr;
+    const uint64_t* keys_ = nullptr; // the sorted radix keys, equal keys map to equal values
+    size_type size_ = 0ull;
+  };
+
   template<typename T>
   struct is_viewer {
     static constexpr auto value = false; 
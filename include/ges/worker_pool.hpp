@@ -0,0 +1,139 @@
+#pragma once
+#include "core.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ges {
+
+  // a fixed set of threads running fire-and-forget jobs,
+  // meant to live across frames and be joined at a sync point by wait()
+  class worker_pool {
+  public:
+    using job_type = void(*)(void*);
+
+  public:
+    explicit worker_pool(size_t threads = std::max(1u, std::thread::hardware_concurrency()) - 1u)
+    {
+      threads_.reserve(threads);
+
+      for(size_t i = 0; i < threads; ++i)
+      {
+        threads_.emplace_back([this] { work(); });
+      }
+    }
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    ~worker_pool()
+    {
+      {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+      }
+      wake_.notify_all();
+
+      for(auto& thread : threads_)
+      {
+        thread.join();
+      }
+    }
+
+    void submit(job_type job, void* payload)
+    {
+      {
+        std::lock_guard lock{mutex_};
+        jobs_.push_back(task{ job, payload });
+        ++unfinished_;
+      }
+      wake_.notify_one();
+    }
+
+    // blocks until every submitted job is done, the calling thread helps in the meantime
+    void wait()
+    {
+      std::unique_lock lock{mutex_};
+
+      while(unfinished_)
+      {
+        if(jobs_.empty())
+        {
+          done_.wait(lock);
+          continue;
+        }
+
+        execute(lock);
+      }
+    }
+
+    // blocks until 'done' returns true, e.g. once the jobs of one batch are, the calling thread helps
+    // in the meantime. Jobs run in the order they were submitted, so the older ones go first
+    template<typename Predicate>
+    void wait(Predicate done)
+    {
+      std::unique_lock lock{mutex_};
+
+      while(!done())
+      {
+        if(jobs_.empty())
+        {
+          done_.wait(lock);
+          continue;
+        }
+
+        execute(lock);
+      }
+    }
+
+    // the number of threads, the one calling wait() excluded
+    size_t size() const { return threads_.size(); }
+
+  private:
+    struct task {
+      job_type job;
+      void* payload;
+    };
+
+    void work()
+    {
+      std::unique_lock lock{mutex_};
+
+      while(true)
+      {
+        wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+
+        if(jobs_.empty())
+          return;
+
+        execute(lock);
+      }
+    }
+
+    void execute(std::unique_lock<std::mutex>& lock)
+    {
+      task next = jobs_.front();
+      jobs_.pop_front();
+
+      lock.unlock();
+      next.job(next.payload);
+      lock.lock();
+
+      --unfinished_;
+      done_.notify_all();
+    }
+
+  private:
+    std::vector<std::thread> threads_;
+    std::deque<task> jobs_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    size_t unfinished_ = 0;
+    bool stop_ = false;
+  };
+
+} // namespace ges
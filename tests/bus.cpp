@@ -0,0 +1,394 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <atomic>
+#include <numeric>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  struct tick { int value; };
+
+  // counts the live instances so drops can be checked for leaks
+  struct tracked {
+    static inline int alive = 0;
+
+    std::string text;
+
+    tracked(std::string text) : text{std::move(text)} { ++alive; }
+    tracked(const tracked& other) : text{other.text} { ++alive; }
+    tracked(tracked&& other) noexcept : text{std::move(other.text)} { ++alive; }
+    ~tracked() { --alive; }
+  };
+
+  std::vector<int> ticks;
+  size_t tracked_seen = 0;
+
+  void on_tick(const tick& event) { ticks.push_back(event.value); }
+  void on_tracked(const tracked&) { ++tracked_seen; }
+
+  std::vector<tick> sequence(size_t count)
+  {
+    std::vector<tick> events(count);
+
+    for(size_t i = 0; i < count; ++i)
+      events[i].value = static_cast<int>(i);
+
+    return events;
+  }
+
+}
+
+GES_TEST(bus_reject_and_drop_newest)
+{
+  ges::dispatcher events;
+  events.listen<tick, on_tick>();
+  events.set_bus_policy({ .event_budget = 4, .overflow = ges::overflow_policy::reject });
+
+  int stored = 0;
+
+  for(int i = 0; i < 10; ++i)
+    stored += events.try_emit_bus<tick>(tick{ i });
+
+  GES_CHECK(stored == 4);
+  GES_CHECK(events.stats_bus().pending == 4 && events.stats_bus().rejected == 6);
+
+  ticks.clear();
+  events.run_bus();
+  GES_CHECK((ticks == std::vector<int>{ 0, 1, 2, 3 }));
+
+  events.set_bus_policy({ .event_budget = 4, .overflow = ges::overflow_policy::drop_newest });
+
+  for(int i = 0; i < 10; ++i)
+    events.emit_bus<tick>(tick{ i });
+
+  GES_CHECK(events.stats_bus().dropped == 6 && events.stats_bus().rejected == 6);
+}
+
+GES_TEST(bus_drop_oldest_pages)
+{
+  tracked::alive = 0;
+  tracked_seen = 0;
+  {
+    ges::dispatcher events;
+    events.listen<tracked, on_tracked>();
+    events.set_bus_policy({ .byte_budget = 3 * ges::event_queue::PAGE_SIZE, .overflow = ges::overflow_policy::drop_oldest });
+
+    const int count = 200000;
+
+    for(int i = 0; i < count; ++i)
+      events.emit_bus<tracked>(std::to_string(i));
+
+    const auto stats = events.stats_bus();
+
+    GES_CHECK(stats.used <= 3 * ges::event_queue::PAGE_SIZE);
+    GES_CHECK(stats.dropped_pages > 0);
+    GES_CHECK(stats.pending + stats.dropped == size_t(count));
+    GES_CHECK(tracked::alive == int(stats.pending));
+
+    events.run_bus();
+
+    GES_CHECK(tracked_seen == stats.pending);
+    GES_CHECK(tracked::alive == 0);
+  }
+  GES_CHECK(tracked::alive == 0);
+}
+
+GES_TEST(bus_spill_keeps_order)
+{
+  ges::dispatcher events;
+  events.listen<tick, on_tick>();
+  events.set_bus_policy({ .event_budget = 10, .overflow = ges::overflow_policy::spill });
+
+  const auto range = sequence(100);
+  events.emit_bus_range<tick>(range.begin(), range.end());
+
+  const auto stats = events.stats_bus();
+
+  GES_CHECK(stats.pending == 100);
+  GES_CHECK(stats.spilled == 90);
+
+  ticks.clear();
+  events.run_bus();
+
+  std::vector<int> expected(100);
+  std::iota(expected.begin(), expected.end(), 0);
+
+  GES_CHECK(ticks == expected);
+  GES_CHECK(events.stats_bus().pending == 0);
+}
+
+GES_TEST(bus_trim)
+{
+  ges::dispatcher events;
+  events.listen<tick, on_tick>();
+
+  const auto range = sequence(4 * ges::event_queue::PAGE_SIZE / ges::event_queue::slot_size<tick>());
+  events.emit_bus_range<tick>(range.begin(), range.end());
+
+  GES_CHECK(events.stats_bus().reserved >= 4 * ges::event_queue::PAGE_SIZE);
+
+  events.run_bus();
+  events.trim();
+
+  GES_CHECK(events.stats_bus().reserved == ges::event_queue::PAGE_SIZE);
+}
+
+namespace {
+
+  std::atomic<bool> blocked = false;
+  std::atomic<bool> released = false;
+  std::atomic<int> passed_by = 0;
+  std::atomic<int> offloaded = 0;
+  int deferred = 0;
+
+  // holds the service consumer in the middle of a dispatch
+  void block(const tick&)
+  {
+    blocked = true;
+
+    while(!released)
+      std::this_thread::yield();
+  }
+
+  void pass_by(const tick&) { ++passed_by; }
+  void on_tick_worker(const tick& event) { offloaded += event.value; }
+  void on_tick_main(const tick& event) { deferred += event.value; }
+
+}
+
+GES_TEST(service_keeps_snapshots_across_frames)
+{
+  ges::dispatcher events;
+  events.listen<tick, pass_by>().listen<tick, block>();
+
+  blocked = false;
+  released = false;
+  passed_by = 0;
+
+  events.start_service();
+
+  std::thread consumer([&] { events.run_bus_blocking(); });
+
+  events.emit_bus<tick>(tick{ 1 });
+
+  while(!blocked)
+    std::this_thread::yield();
+
+  // the consumer is still going through the listeners it picked up
+  events.unlisten<tick, pass_by>();
+  events.run();
+  events.run();
+
+  released = true;
+
+  events.stop_service();
+  consumer.join();
+
+  GES_CHECK(passed_by == 1);
+}
+
+GES_TEST(service_detaches_its_own_batches)
+{
+  ges::dispatcher events;
+  events.listen<tick, on_tick_worker>(ges::execution_policy::worker);
+  events.listen<tick, on_tick_main>(ges::execution_policy::main);
+
+  offloaded = 0;
+  deferred = 0;
+
+  events.start_service();
+
+  std::thread consumer([&] { events.run_bus_blocking(); });
+
+  int sent = 0;
+
+  // the frame emits and joins on this thread while the consumer dispatches the bus
+  for(int frame = 0; frame < 500; ++frame)
+  {
+    events.emit_bus<tick>(tick{ 1 });
+    events.emit<tick>(tick{ 1 });
+    sent += 2;
+
+    events.run();
+  }
+
+  events.stop_service();
+  consumer.join();
+
+  events.run();
+  events.join();
+
+  GES_CHECK(offloaded == sent);
+  GES_CHECK(deferred == sent);
+}
+
+namespace {
+
+  struct alert { int value; };
+
+  ges::dispatcher* current = nullptr;
+  std::string lanes_seen;
+
+  void on_tick_lane(const tick& event) { lanes_seen += char('a' + event.value); }
+  void on_alert(const alert&) { lanes_seen += '!'; }
+
+  // raises an alert the first time, which jumps the backlog in strict order
+  void on_tick_alarm(const tick& event)
+  {
+    lanes_seen += char('a' + event.value);
+
+    if(event.value == 0)
+      current->emit_bus<alert>(alert{ 1 });
+  }
+
+}
+
+GES_TEST(bus_lanes_strict)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.set_lanes(3, ges::lane_order::strict, 2);
+  events.listen<tick, on_tick_lane>().listen<alert, on_alert>().set_lane<alert>(0);
+
+  lanes_seen.clear();
+
+  // the default lane is the last one
+  events.emit_bus<tick>(tick{ 2 });
+  events.emit_bus<tick>(tick{ 2 });
+  events.emit_bus_to<tick>(1, tick{ 1 });
+  events.emit_bus<alert>(alert{ 1 });
+  events.emit_bus_to<tick>(7, tick{ 2 });
+
+  events.run_bus();
+
+  GES_CHECK(lanes_seen == "!bccc");
+}
+
+GES_TEST(bus_lanes_strict_jump_the_backlog)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.set_lanes(2, ges::lane_order::strict, 1);
+  events.listen<tick, on_tick_alarm>().listen<alert, on_alert>().set_lane<alert>(0);
+
+  lanes_seen.clear();
+
+  events.emit_bus<tick>(tick{ 0 });
+  events.emit_bus<tick>(tick{ 1 });
+  events.emit_bus<tick>(tick{ 1 });
+  events.run_bus();
+
+  GES_CHECK(lanes_seen == "a!bb");
+}
+
+GES_TEST(bus_lanes_weighted)
+{
+  ges::dispatcher events;
+
+  events.set_lanes(2, ges::lane_order::weighted);
+  events.set_lane_weight(0, 2).set_lane_weight(1, 1);
+  events.listen<tick, on_tick_lane>();
+
+  lanes_seen.clear();
+
+  for(int i = 0; i < 4; ++i)
+  {
+    events.emit_bus_to<tick>(0, tick{ 0 });
+    events.emit_bus_to<tick>(1, tick{ 1 });
+  }
+
+  events.run_bus();
+
+  GES_CHECK(lanes_seen == "aabaabbb");
+}
+
+GES_TEST(run_bus_for_a_whole_event_at_a_time)
+{
+  ges::dispatcher events;
+  events.set_lanes(2, ges::lane_order::strict, 1);
+  events.listen<tick, on_tick>();
+  events.set_bus_policy({ .event_budget = 4, .overflow = ges::overflow_policy::spill });
+
+  ticks.clear();
+
+  for(int i = 0; i < 8; ++i)
+    events.emit_bus<tick>(tick{ i });
+
+  events.emit_bus_to<tick>(0, tick{ 100 });
+
+  // a spent budget still dispatches an event per call
+  size_t seen = 0;
+
+  while(!events.run_bus_for(std::chrono::nanoseconds{ 0 }))
+  {
+    GES_CHECK(ticks.size() > seen && ticks.size() < 9);
+    seen = ticks.size();
+  }
+
+  // once spilling, even the first lane waits behind the spill to keep the order
+  GES_CHECK((ticks == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 100 }));
+  GES_CHECK(events.stats_bus().pending == 0);
+}
+
+namespace {
+
+  struct alignas(32) wide { float lanes[8]; };
+  struct alignas(64) line { int value; };
+  struct tiny { uint8_t value; };
+
+  size_t misaligned = 0;
+  int wide_seen = 0;
+
+  void on_wide(const wide& event)
+  {
+    misaligned += reinterpret_cast<uintptr_t>(&event) % alignof(wide) != 0;
+    wide_seen += static_cast<int>(event.lanes[7]);
+  }
+
+  void on_line(const line& event) { misaligned += reinterpret_cast<uintptr_t>(&event) % alignof(line) != 0; }
+  void on_tiny(const tiny&) { }
+
+}
+
+GES_TEST(bus_slots_are_compact)
+{
+  using queue = ges::event_queue;
+
+  GES_CHECK(queue::slot_size<tiny>() == 8);
+  GES_CHECK(queue::slot_size<tick>() == 8);
+  GES_CHECK(queue::slot_size<wide>() == 64);
+  GES_CHECK(queue::slot_size<line>() == 128);
+}
+
+GES_TEST(bus_keeps_over_aligned_events_aligned)
+{
+  ges::dispatcher events;
+  events.listen<wide, on_wide>().listen<line, on_line>().listen<tiny, on_tiny>();
+
+  misaligned = 0;
+  wide_seen = 0;
+
+  // small events in between shift every following slot
+  for(int i = 0; i < 1000; ++i)
+  {
+    events.emit_bus<tiny>(tiny{ 1 });
+    events.emit_bus<wide>(wide{ { 0, 0, 0, 0, 0, 0, 0, 1 } });
+    events.emit_bus<tiny>(tiny{ 2 });
+    events.emit_bus<line>(line{ i });
+  }
+
+  // replayed events stay aligned too
+  const auto state = events.snapshot();
+
+  events.run_bus();
+  events.restore(state);
+  events.run_bus();
+
+  GES_CHECK(misaligned == 0);
+  GES_CHECK(wide_seen == 2000);
+}
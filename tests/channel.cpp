@@ -0,0 +1,127 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <utility>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct spark { int value; };
+  struct label { std::string text; };
+
+  template<int N>
+  struct filler { int value; };
+
+  std::vector<int> sparks;
+  std::string labels;
+  int sparks_viewed = 0;
+
+  void on_spark(const spark& event) { sparks.push_back(event.value); }
+  void on_label(const label& event) { labels += event.text; }
+  void view_sparks(ges::viewer<spark> events) { sparks_viewed += static_cast<int>(events.size()); }
+
+  template<int N>
+  void on_filler(const filler<N>&) { }
+
+  // registers enough types to make the registry grow
+  template<int... N>
+  void fill(ges::dispatcher& events, std::integer_sequence<int, N...>)
+  {
+    (events.listen<filler<N>, on_filler<N>>(), ...);
+  }
+
+}
+
+GES_TEST(channel_emits_like_the_dispatcher)
+{
+  ges::dispatcher events;
+
+  auto channel = events.channel<spark>();
+
+  GES_CHECK(channel && !channel.subscribed());
+  GES_CHECK(!ges::event_channel<spark>{});
+
+  // nobody listens yet, nothing is stored
+  channel.emit(spark{ -1 });
+  GES_CHECK(channel.view().empty());
+
+  events.listen<spark, on_spark>().listen_view<spark, view_sparks>();
+  GES_CHECK(channel.subscribed());
+
+  sparks.clear();
+  sparks_viewed = 0;
+
+  channel.emit(spark{ 0 });
+  events.emit<spark>(spark{ 1 });
+  channel.emit(spark{ 2 });
+
+  GES_CHECK(channel.view().size() == 3);
+  GES_CHECK(events.view<spark>().size() == 3);
+
+  events.run();
+
+  GES_CHECK((sparks == std::vector<int>{ 0, 1, 2 }));
+  GES_CHECK(sparks_viewed == 3);
+  GES_CHECK(channel.view().empty());
+}
+
+GES_TEST(channel_triggers_and_batches)
+{
+  ges::dispatcher events;
+  events.listen<spark, on_spark>().listen<label, on_label>();
+
+  auto sparks_channel = events.channel<spark>();
+  auto labels_channel = events.channel<label>();
+
+  sparks.clear();
+  labels.clear();
+
+  // runs inline, nothing is queued
+  sparks_channel.trigger(spark{ 7 });
+  GES_CHECK((sparks == std::vector<int>{ 7 }));
+  GES_CHECK(sparks_channel.view().empty());
+
+  {
+    auto batch = sparks_channel.batch();
+
+    for(int i = 0; i < 4; ++i)
+      batch.push_back(spark{ i });
+  }
+
+  labels_channel.emit(label{ "a" });
+  labels_channel.emit(std::string(32, 'b'));
+
+  events.run();
+
+  GES_CHECK((sparks == std::vector<int>{ 7, 0, 1, 2, 3 }));
+  GES_CHECK(labels == "a" + std::string(32, 'b'));
+}
+
+GES_TEST(channel_keeps_budgets_and_survives_new_types)
+{
+  ges::dispatcher events;
+  events.listen<spark, on_spark>();
+  events.set_policy<spark>({ .budget = 4 * sizeof(spark), .overflow = ges::overflow_policy::drop_newest });
+
+  auto channel = events.channel<spark>();
+
+  for(int i = 0; i < 10; ++i)
+    channel.emit(spark{ i });
+
+  GES_CHECK(events.stats<spark>().dropped == 6);
+
+  // the handle points at the type, not into the registry
+  fill(events, std::make_integer_sequence<int, 64>{});
+  events.listen<label, on_label>();
+
+  sparks.clear();
+  channel.emit(spark{ 100 });
+  events.run();
+
+  GES_CHECK((sparks == std::vector<int>{ 0, 1, 2, 3 }));
+
+  channel.emit(spark{ 100 });
+  events.run();
+
+  GES_CHECK((sparks == std::vector<int>{ 0, 1, 2, 3, 100 }));
+}
@@ -0,0 +1,302 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <numeric>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct sample { int value; };
+  struct named { std::string name; };
+
+  std::vector<int> samples;
+  std::vector<std::string> names;
+
+  void on_sample(const sample& event) { samples.push_back(event.value); }
+  void on_named(const named& event) { names.push_back(event.name); }
+
+  std::vector<sample> sequence(size_t count, int first = 0)
+  {
+    std::vector<sample> events(count);
+
+    for(size_t i = 0; i < count; ++i)
+      events[i].value = first + static_cast<int>(i);
+
+    return events;
+  }
+
+  bool ascending(const std::vector<int>& values, int first, size_t count)
+  {
+    std::vector<int> expected(count);
+    std::iota(expected.begin(), expected.end(), first);
+
+    return values == expected;
+  }
+
+}
+
+GES_TEST(emit_range_reserves_once)
+{
+  ges::dispatcher events;
+  events.listen<sample, on_sample>();
+
+  samples.clear();
+
+  const auto range = sequence(1000);
+  events.emit_range<sample>(range.begin(), range.end());
+
+  GES_CHECK(events.stats<sample>().reserved == range.size() * sizeof(sample));
+  GES_CHECK(events.reserved() == range.size() * sizeof(sample));
+
+  // not contiguous, copied one at a time
+  const auto tail = sequence(10, 1000);
+  const std::list<sample> linked(tail.begin(), tail.end());
+  events.emit_range<sample>(linked.begin(), linked.end());
+
+  events.run();
+
+  GES_CHECK(ascending(samples, 0, 1010));
+  GES_CHECK(events.reserved() == events.stats().reserved);
+
+
+  // a budget set afterwards starts from what the range took
+  ges::dispatcher bounded;
+  bounded.listen<sample, on_sample>();
+
+  bounded.emit_range<sample>(range.begin(), range.end());
+  bounded.set_budget(range.size() * sizeof(sample));
+  bounded.emit<sample>(sample{ 0 });
+
+  GES_CHECK(bounded.stats<sample>().rejected == 1);
+}
+
+GES_TEST(emit_range_copies_non_trivial_events)
+{
+  ges::dispatcher events;
+  events.listen<named, on_named>();
+
+  names.clear();
+
+  const std::vector<named> range{ { "short" }, { std::string(64, 'x') }, { "" } };
+  events.emit_range<named>(range.begin(), range.end());
+  events.run();
+
+  GES_CHECK(names.size() == 3 && names[0] == "short" && names[1] == range[1].name && names[2].empty());
+  GES_CHECK(range[1].name == std::string(64, 'x'));
+}
+
+GES_TEST(batcher_append)
+{
+  ges::dispatcher events;
+  events.listen<sample, on_sample>();
+
+  samples.clear();
+
+  const auto range = sequence(100);
+
+  auto batch = events.batch<sample>();
+  batch.append(range);
+  batch.push_back(sample{ 100 });
+
+  GES_CHECK(batch.size() == 101);
+  GES_CHECK(events.view<sample>().size() == 101);
+
+  events.run();
+
+  GES_CHECK(ascending(samples, 0, 101));
+}
+
+GES_TEST(emit_bus_range_spans_pages)
+{
+  ges::dispatcher events;
+  events.listen<sample, on_sample>().listen<named, on_named>();
+
+  samples.clear();
+  names.clear();
+
+  // more than a page worth of slots
+  const auto range = sequence(2 * ges::event_queue::PAGE_SIZE / ges::event_queue::slot_size<sample>() + 7);
+
+  events.emit_bus<sample>(sample{ -1 });
+  events.emit_bus_range<sample>(range.begin(), range.end());
+
+  const std::vector<named> strings{ { "bus" }, { std::string(40, 'y') } };
+  events.emit_bus_range<named>(strings.begin(), strings.end());
+
+  GES_CHECK(events.stats_bus().pending == range.size() + 1 + strings.size());
+
+  events.run_bus();
+
+  GES_CHECK(ascending(samples, -1, range.size() + 1));
+  GES_CHECK(names.size() == 2 && names[1] == strings[1].name);
+  GES_CHECK(events.stats_bus().pending == 0);
+}
+
+namespace {
+
+  struct debug_probe { int value; };
+  struct never_registered { int value; };
+
+  int built = 0;
+  int probes = 0;
+
+  debug_probe build_probe()
+  {
+    ++built;
+    return debug_probe{ 1 };
+  }
+
+  void on_probe(const debug_probe& event) { probes += event.value; }
+
+}
+
+GES_TEST(emit_skips_unsubscribed_types)
+{
+  ges::dispatcher events;
+
+  // not even registered, a no-op instead of a throw
+  events.emit<never_registered>(never_registered{ 1 });
+  GES_CHECK(events.try_emit<never_registered>(never_registered{ 1 }));
+  GES_CHECK(!events.contains<never_registered>());
+
+  events.listen<debug_probe, on_probe>();
+  events.unlisten<debug_probe, on_probe>();
+
+  // registered but nobody listens
+  const auto range = sequence(10);
+  events.emit<debug_probe>(debug_probe{ 1 });
+  events.emit_range<sample>(range.begin(), range.end());
+  events.emit_bus<debug_probe>(debug_probe{ 1 });
+
+  GES_CHECK(events.stats<debug_probe>().used == 0);
+  GES_CHECK(events.stats_bus().pending == 0);
+}
+
+GES_TEST(emit_lazy_builds_only_for_subscribers)
+{
+  ges::dispatcher events;
+
+  built = 0;
+  probes = 0;
+
+  events.emit_lazy<debug_probe>(build_probe);
+  GES_CHECK(built == 0);
+
+  events.listen<debug_probe, on_probe>();
+
+  events.emit_lazy<debug_probe>(build_probe);
+  events.emit_lazy<debug_probe>([] { return debug_probe{ 10 }; });
+  events.run();
+
+  GES_CHECK(built == 1);
+  GES_CHECK(probes == 11);
+
+  // a budget that refuses the event doesn't build it either
+  events.set_policy<debug_probe>({ .budget = sizeof(debug_probe) });
+
+  events.emit_lazy<debug_probe>(build_probe);
+  events.emit_lazy<debug_probe>(build_probe);
+
+  GES_CHECK(built == 2);
+}
+
+namespace {
+
+  int released = 0;
+
+  void release(void* context)
+  {
+    ++released;
+    *static_cast<bool*>(context) = true;
+  }
+
+  std::atomic<int> offloaded = 0;
+  std::atomic<int> consumed = 0;
+
+  void on_sample_worker(const sample& event) { offloaded += event.value; }
+  void consume_sample(sample&& event) { consumed += event.value; }
+
+}
+
+GES_TEST(external_buffers_are_dispatched_in_place)
+{
+  ges::dispatcher events;
+  events.listen<sample, on_sample>();
+
+  samples.clear();
+  released = 0;
+
+  const auto packet = sequence(5, 10);
+  bool recycled = false;
+
+  events.emit<sample>(sample{ 0 });
+  events.submit_external<sample>(std::span<const sample>(packet), release, &recycled);
+
+  GES_CHECK(!recycled);
+
+  events.run();
+
+  GES_CHECK(recycled && released == 1);
+  GES_CHECK(samples.size() == 6);
+  GES_CHECK(std::count(samples.begin(), samples.end(), 0) == 1);
+  GES_CHECK(std::accumulate(samples.begin(), samples.end(), 0) == 60);
+
+  // nobody to dispatch to, handed back right away
+  recycled = false;
+  events.unlisten<sample, on_sample>();
+  events.submit_external<sample>(std::span<const sample>(packet), release, &recycled);
+
+  GES_CHECK(recycled && released == 2);
+}
+
+GES_TEST(external_buffers_are_copied_for_workers)
+{
+  ges::dispatcher events;
+  events.listen<sample, on_sample_worker>(ges::execution_policy::worker);
+
+  offloaded = 0;
+  released = 0;
+
+  auto packet = sequence(4, 1);
+  bool recycled = false;
+
+  events.submit_external<sample>(std::span<const sample>(packet), release, &recycled);
+  events.run();
+
+  // handed back once copied, the workers have until the next frame boundary
+  GES_CHECK(recycled);
+
+  // the buffer can be recycled while the copies are still alive
+  packet.assign(4, sample{ -1 });
+  events.run();
+
+  GES_CHECK(offloaded == 10);
+}
+
+GES_TEST(external_buffers_skip_the_consumer)
+{
+  const auto packet = sequence(4, 1);
+
+  for(auto policy : { ges::execution_policy::immediate, ges::execution_policy::worker, ges::execution_policy::main })
+  {
+    ges::dispatcher events;
+    events.listen<sample, on_sample_worker>(policy).listen_consume<sample, consume_sample>();
+
+    offloaded = 0;
+    consumed = 0;
+
+    events.emit<sample>(sample{ 100 });
+    events.submit_external<sample>(std::span<const sample>(packet));
+
+    // the worker listeners have until the boundary after the next one
+    events.run();
+    events.run();
+
+    GES_CHECK(offloaded == 110);
+    GES_CHECK(consumed == 100);
+  }
+}
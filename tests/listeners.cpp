@@ -0,0 +1,746 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <ges/worker_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  // counts the live instances, the copies made of them and what was done to destroyed ones
+  struct payload {
+    static inline int alive = 0;
+    static inline int copies = 0;
+    static inline int dead = 0;
+
+    std::string text;
+    bool live = true;
+
+    payload(std::string text) : text{std::move(text)} { ++alive; }
+    payload(const payload& other) : text{other.text} { ++alive; ++copies; dead += !other.live; }
+    payload(payload&& other) noexcept : text{std::move(other.text)} { ++alive; dead += !other.live; }
+    ~payload() { --alive; dead += !live; live = false; }
+  };
+
+  std::string trail;
+  std::vector<std::string> kept;
+
+  void look(const payload& event) { trail += "l" + std::to_string(event.text.size()); }
+
+  void keep(payload&& event)
+  {
+    trail += 'c';
+    kept.push_back(std::move(event.text));
+  }
+
+  struct keeper {
+    size_t bytes = 0;
+    void take(payload&& event) { bytes += std::string(std::move(event.text)).size(); }
+  };
+
+}
+
+GES_TEST(consumer_runs_last_and_moves)
+{
+  trail.clear();
+  kept.clear();
+  payload::alive = payload::copies = 0;
+  {
+    ges::dispatcher events;
+    events.listen<payload, look>().listen_consume<payload, keep>();
+
+    events.emit<payload>(std::string(40, 'a'));
+    events.emit<payload>(std::string(50, 'b'));
+    events.run();
+
+    // every listener saw the batch before it was consumed
+    GES_CHECK(trail == "l40l50cc");
+    GES_CHECK(kept.size() == 2 && kept[0] == std::string(40, 'a') && kept[1] == std::string(50, 'b'));
+    GES_CHECK(payload::copies == 0);
+    GES_CHECK(payload::alive == 0);
+
+    events.emit_bus<payload>(std::string(60, 'c'));
+    events.run_bus();
+
+    GES_CHECK(kept.size() == 3 && kept[2].size() == 60);
+    GES_CHECK(payload::alive == 0);
+
+    // the event belongs to the caller
+    trail.clear();
+    events.trigger(payload{ "t" });
+    GES_CHECK(trail == "l1" && kept.size() == 3);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+namespace {
+
+  ges::dispatcher* emitter = nullptr;
+
+  // emits to the type being dispatched on the last event, growing its pool under the batch
+  void look_and_emit(const payload& event)
+  {
+    trail += 'l';
+
+    if(event.text[0] == 'c')
+    {
+      for(int i = 0; i < 64; ++i)
+        emitter->emit<payload>(std::string(40, 'z'));
+    }
+  }
+
+}
+
+GES_TEST(consumer_survives_the_pool_growing)
+{
+  trail.clear();
+  kept.clear();
+  payload::alive = payload::dead = 0;
+  {
+    ges::dispatcher events;
+    emitter = &events;
+
+    events.listen<payload, look_and_emit>().listen_consume<payload, keep>();
+
+    for(char c : { 'a', 'b', 'c' })
+      events.emit<payload>(std::string(40, c));
+
+    events.run();
+
+    GES_CHECK(trail == "lllccc");
+    GES_CHECK(kept.size() == 3 && kept[0][0] == 'a' && kept[2][0] == 'c');
+
+    // the events emitted by the listener waited for the next pass
+    GES_CHECK(payload::alive == 64);
+
+    kept.clear();
+    events.run();
+
+    GES_CHECK(kept.size() == 64);
+    GES_CHECK(payload::alive == 0);
+  }
+  GES_CHECK(payload::alive == 0 && payload::dead == 0);
+}
+
+namespace {
+
+  // consumes, and hands a follow up to the next pass for the first event
+  void keep_and_emit(payload&& event)
+  {
+    trail += 'c';
+    kept.push_back(std::move(event.text));
+
+    if(kept.size() == 1)
+      emitter->emit<payload>(std::string(10, 'f'));
+  }
+
+}
+
+GES_TEST(consumer_under_run_for_takes_what_the_listeners_saw)
+{
+  trail.clear();
+  kept.clear();
+  payload::alive = payload::dead = 0;
+  {
+    ges::dispatcher events;
+    emitter = &events;
+
+    events.listen<payload, look_and_emit>().listen_consume<payload, keep_and_emit>();
+    events.emit<payload>(std::string(40, 'a'));
+
+    // a spent budget resumes the pass a call at a time
+    while(!events.run_for(std::chrono::nanoseconds{ 0 }));
+
+    // the follow up waits for the next pass, no listener saw it yet
+    GES_CHECK(trail == "lc");
+    GES_CHECK(kept.size() == 1 && payload::alive == 1);
+
+    GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+
+    GES_CHECK(trail == "lclc");
+    GES_CHECK(kept.size() == 2 && kept[1] == std::string(10, 'f'));
+    GES_CHECK(payload::alive == 0);
+  }
+  GES_CHECK(payload::alive == 0 && payload::dead == 0);
+}
+
+GES_TEST(consumer_replaced_and_removed)
+{
+  kept.clear();
+  payload::alive = 0;
+  {
+    ges::dispatcher events;
+    keeper sink;
+
+    events.listen_consume<payload, keep>();
+    events.listen_consume<payload, &keeper::take>(&sink);
+
+    events.emit<payload>(std::string(7, 'q'));
+    events.run();
+
+    GES_CHECK(kept.empty() && sink.bytes == 7);
+
+    GES_CHECK(events.unlisten_consume<payload>());
+    GES_CHECK(!events.unlisten_consume<payload>());
+
+    // nobody is left to see the event
+    events.emit<payload>(std::string(8, 'q'));
+    GES_CHECK(events.view<payload>().empty());
+
+    events.listen<payload, look>();
+    events.emit<payload>(std::string(9, 'q'));
+    events.run();
+
+    GES_CHECK(sink.bytes == 7);
+    GES_CHECK(payload::alive == 0);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+namespace {
+
+  struct parcel { int value; };
+
+  std::atomic<int> parcels = 0;
+  std::atomic<int> parcels_kept = 0;
+
+  void on_parcel(const parcel&) { ++parcels; }
+  void keep_parcel(parcel&& event) { parcels_kept += event.value; }
+  void keep_parcel_twice(parcel&& event) { parcels_kept += 2 * event.value; }
+
+}
+
+GES_TEST(consumer_from_another_thread)
+{
+  ges::dispatcher events;
+  events.listen<parcel, on_parcel>();
+
+  parcels = 0;
+  parcels_kept = 0;
+
+  std::atomic<bool> done = false;
+
+  std::thread tool([&] {
+    for(int i = 0; i < 2000; ++i)
+    {
+      if(i & 1)
+        events.listen_consume<parcel, keep_parcel>();
+      else
+        events.listen_consume<parcel, keep_parcel_twice>();
+
+      if(i % 3 == 0)
+        events.unlisten_consume<parcel>();
+
+      std::this_thread::yield();
+    }
+
+    done = true;
+  });
+
+  int frames = 0;
+
+  while(!done || frames < 3)
+  {
+    events.emit<parcel>(parcel{ 1 });
+    events.run();
+    ++frames;
+  }
+
+  tool.join();
+
+  // the last listen_consume of the loop stuck
+  GES_CHECK(events.unlisten_consume<parcel>());
+  GES_CHECK(parcels == frames);
+  GES_CHECK(parcels_kept <= 2 * frames);
+}
+
+GES_TEST(consumer_of_an_unseen_type_waits_for_the_boundary)
+{
+  ges::dispatcher events;
+
+  parcels_kept = 0;
+
+  std::thread tool([&] {
+    events.listen_consume<parcel, keep_parcel_twice>();
+    events.unlisten_consume<parcel>();
+    events.listen_consume<parcel, keep_parcel>();
+  });
+
+  tool.join();
+
+  GES_CHECK(!events.contains<parcel>());
+
+  events.run();
+
+  GES_CHECK(events.contains<parcel>());
+
+  events.emit<parcel>(parcel{ 5 });
+  events.run();
+
+  GES_CHECK(parcels_kept == 5);
+}
+
+namespace {
+
+  struct ping { int value; };
+  struct late { int value; };
+
+  ges::dispatcher* current = nullptr;
+  std::atomic<int> pinged = 0;
+  std::atomic<int> pinged_more = 0;
+  std::atomic<int> late_seen = 0;
+
+  void on_ping(const ping&) { pinged += 1; }
+  void on_ping_more(const ping&) { pinged_more += 1; }
+  void on_late(const late&) { late_seen += 1; }
+
+  // swaps itself for on_ping_more in the middle of a pass
+  void swap_self(const ping&)
+  {
+    pinged += 10;
+
+    if(current->unlisten<ping, swap_self>())
+      current->listen<ping, on_ping_more>();
+  }
+
+}
+
+GES_TEST(listen_inside_handler_applies_next_pass)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<ping, on_ping>().listen<ping, swap_self>();
+
+  pinged = 0;
+  pinged_more = 0;
+  events.emit<ping>(ping{ 1 });
+  events.emit<ping>(ping{ 2 });
+  events.run();
+
+  // the pass kept the snapshot it started with
+  GES_CHECK(pinged == 22 && pinged_more == 0);
+
+  pinged = 0;
+  events.emit<ping>(ping{ 1 });
+  events.run();
+
+  GES_CHECK(pinged == 1 && pinged_more == 1);
+}
+
+GES_TEST(listen_from_another_thread)
+{
+  ges::dispatcher events;
+  events.listen<ping, on_ping>();
+
+  std::atomic<bool> done = false;
+
+  std::thread tool([&] {
+    // a type the dispatcher hasn't seen waits for the frame boundary
+    events.listen<late, on_late>();
+
+    for(int i = 0; i < 2000; ++i)
+    {
+      events.listen<ping, on_ping_more>();
+      events.unlisten<ping, on_ping_more>();
+    }
+
+    done = true;
+  });
+
+  pinged = 0;
+  late_seen = 0;
+
+  int frames = 0;
+
+  while(!done || frames < 3)
+  {
+    events.emit<ping>(ping{ 1 });
+    events.emit<late>(late{ 1 });
+    events.run();
+    ++frames;
+  }
+
+  tool.join();
+
+  // the last frame may have ended before the tool listened
+  events.run();
+
+  GES_CHECK(events.contains<late>());
+
+  // every ping reached the listener that never left
+  GES_CHECK(pinged == frames);
+
+  late_seen = 0;
+  events.emit<late>(late{ 1 });
+  events.run();
+
+  GES_CHECK(late_seen == 1);
+}
+
+namespace {
+
+  std::thread::id main_thread;
+  std::atomic<int> offloaded_bytes = 0;
+  int deferred_seen = 0;
+  int deferred_on_main = 0;
+
+  void on_worker(const payload& event)
+  {
+    offloaded_bytes += static_cast<int>(event.text.size());
+  }
+
+  void on_main(const payload& event)
+  {
+    // the inline listeners are done by now
+    trail += 'm';
+    deferred_seen += static_cast<int>(event.text.size());
+    deferred_on_main += std::this_thread::get_id() == main_thread;
+  }
+
+}
+
+GES_TEST(worker_and_main_listeners)
+{
+  main_thread = std::this_thread::get_id();
+  offloaded_bytes = 0;
+  deferred_seen = 0;
+  deferred_on_main = 0;
+  payload::alive = payload::copies = 0;
+  {
+    ges::dispatcher events;
+    events.listen<payload, on_worker>(ges::execution_policy::worker);
+    events.listen<payload, on_main>(ges::execution_policy::main);
+    events.listen<payload, look>();
+
+    // the pool is reused across frames
+    for(int frame = 0; frame < 3; ++frame)
+    {
+      trail.clear();
+
+      events.emit<payload>(std::string(100, 'w'));
+      events.emit<payload>(std::string(20, 'w'));
+      events.run();
+
+      // the batch outlives the frame, the next boundary joins it
+      GES_CHECK(trail == "l100l20mm");
+      GES_CHECK(payload::alive == 2);
+    }
+
+    events.join();
+
+    GES_CHECK(payload::alive == 0);
+    GES_CHECK(offloaded_bytes == 360);
+    GES_CHECK(deferred_seen == 360 && deferred_on_main == 6);
+    GES_CHECK(payload::copies == 0);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+GES_TEST(consumer_runs_after_detached_listeners)
+{
+  kept.clear();
+  trail.clear();
+  deferred_seen = 0;
+  offloaded_bytes = 0;
+  payload::alive = 0;
+  {
+    ges::dispatcher events;
+    events.listen<payload, on_worker>(ges::execution_policy::worker);
+    events.listen<payload, on_main>(ges::execution_policy::main);
+    events.listen_consume<payload, keep>();
+
+    events.emit<payload>(std::string(30, 'k'));
+    events.run();
+
+    // the workers have until the next frame boundary
+    GES_CHECK(trail == "m" && kept.empty());
+
+    events.run();
+
+    GES_CHECK(trail == "mc");
+    GES_CHECK(offloaded_bytes == 30 && deferred_seen == 30);
+    GES_CHECK(kept.size() == 1 && kept[0].size() == 30);
+    GES_CHECK(payload::alive == 0);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+namespace {
+
+  std::atomic<bool> pooled = false;
+  std::thread::id pooled_on;
+
+  void on_pooled(const payload&)
+  {
+    pooled_on = std::this_thread::get_id();
+    pooled = true;
+  }
+
+  void record_thread(void* id)
+  {
+    *static_cast<std::thread::id*>(id) = std::this_thread::get_id();
+  }
+
+}
+
+GES_TEST(worker_listeners_run_on_the_pool_of_set_workers)
+{
+  ges::worker_pool workers{ 1 };
+
+  // the thread of the pool, the caller of wait may take the job instead
+  std::thread::id pool_thread = std::this_thread::get_id();
+
+  while(pool_thread == std::this_thread::get_id())
+  {
+    workers.submit(record_thread, &pool_thread);
+    workers.wait();
+  }
+
+  ges::dispatcher events;
+  events.set_workers(workers);
+  events.listen<payload, on_pooled>(ges::execution_policy::worker);
+
+  pooled = false;
+
+  events.emit<payload>(std::string(8, 'p'));
+  events.run();
+
+  // nothing waits for it before the next frame boundary, the thread of the pool picks it up
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+  while(!pooled && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::yield();
+
+  GES_CHECK(pooled && pooled_on == pool_thread);
+
+  events.join();
+}
+
+GES_TEST(run_of_a_type_closes_the_frame)
+{
+  trail.clear();
+  deferred_seen = 0;
+  payload::alive = 0;
+  {
+    ges::dispatcher events;
+    events.listen<payload, on_main>(ges::execution_policy::main);
+    events.listen<payload, look>();
+
+    events.emit<payload>(std::string(12, 't'));
+    events.run<payload>();
+
+    // the main listeners ran at the boundary closing the frame, like with run()
+    GES_CHECK(trail == "l12m" && deferred_seen == 12);
+
+    events.run<payload>();
+
+    GES_CHECK(payload::alive == 0);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+namespace {
+
+  struct key_press { int key; };
+  struct kill { int killer; };
+
+  constexpr int KEY_E = 5;
+
+  std::string pressed;
+  std::atomic<int> kills = 0;
+
+  bool is_e(const key_press& event) { return event.key == KEY_E; }
+
+  void on_e(const key_press&) { pressed += 'e'; }
+  void on_any(const key_press&) { pressed += '.'; }
+  void on_key(const key_press& event) { pressed += char('0' + event.key); }
+  void on_kill(const kill&) { ++kills; }
+
+  // a type nobody listened to yet, filtered from inside a pass
+  void watch_kills(const ping&)
+  {
+    if(!current->contains<kill>())
+      current->listen_when<kill, &kill::killer, on_kill>(1);
+  }
+
+}
+
+namespace {
+
+  std::atomic<bool> worker_released = false;
+  std::atomic<int> worker_finished = 0;
+
+  // gives up after a while rather than hanging the test
+  void on_slow_worker(const payload&)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while(!worker_released && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::yield();
+
+    ++worker_finished;
+  }
+
+}
+
+GES_TEST(slow_worker_listeners_dont_hold_the_frame)
+{
+  kept.clear();
+  trail.clear();
+  worker_released = false;
+  worker_finished = 0;
+  payload::alive = 0;
+  {
+    ges::dispatcher events;
+    events.listen<payload, on_slow_worker>(ges::execution_policy::worker);
+    events.listen_consume<payload, keep>();
+
+    events.emit<payload>(std::string(8, 's'));
+    events.run();
+
+    GES_CHECK(worker_finished == 0 && kept.empty());
+
+    // the next boundary waits for the worker, then the consumer runs
+    worker_released = true;
+    events.run();
+
+    GES_CHECK(worker_finished == 1 && trail == "c" && kept.size() == 1);
+  }
+  GES_CHECK(payload::alive == 0);
+}
+
+GES_TEST(listen_if_and_listen_when)
+{
+  ges::dispatcher events;
+
+  events.listen_if<key_press, on_e, is_e>();
+  events.listen_if<key_press>([](const key_press& event) { return event.key > 7; }, on_any);
+  events.listen_when<key_press, &key_press::key, on_key>(3);
+  events.listen_when<key_press, &key_press::key, on_key>(4);
+
+  pressed.clear();
+
+  for(int key : { 3, 5, 8, 4, 1 })
+    events.emit<key_press>(key_press{ key });
+
+  events.run();
+
+  GES_CHECK(pressed == "3e.4");
+
+  GES_CHECK((events.unlisten_when<key_press, &key_press::key, on_key>(3)));
+  GES_CHECK((!events.unlisten_when<key_press, &key_press::key, on_key>(3)));
+
+  pressed.clear();
+  events.emit<key_press>(key_press{ 3 });
+  events.emit<key_press>(key_press{ 4 });
+  events.run();
+
+  GES_CHECK(pressed == "4");
+}
+
+GES_TEST(listen_when_waits_for_the_frame_boundary)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<ping, watch_kills>();
+
+  kills = 0;
+
+  events.emit<ping>(ping{ 1 });
+  events.run();
+
+  // registered at the end of the pass that asked for it
+  GES_CHECK(events.contains<kill>());
+
+  events.emit<kill>(kill{ 1 });
+  events.emit<kill>(kill{ 2 });
+  events.run();
+
+  GES_CHECK(kills == 1);
+
+  // from another thread, cancelled before the boundary
+  ges::dispatcher other;
+
+  std::thread tool([&] {
+    other.listen_when<kill, &kill::killer, on_kill>(2);
+    other.listen_when<kill, &kill::killer, on_kill>(3);
+    other.unlisten_when<kill, &kill::killer, on_kill>(3);
+  });
+
+  tool.join();
+
+  GES_CHECK(!other.contains<kill>());
+
+  other.run();
+
+  kills = 0;
+
+  for(int killer : { 1, 2, 3 })
+    other.emit<kill>(kill{ killer });
+
+  other.run();
+
+  GES_CHECK(kills == 1);
+}
+
+namespace {
+
+  struct damage { int amount; };
+  struct fire_damage : damage { int heat; };
+  struct poison_damage : damage { int ticks; };
+  struct burn : fire_damage { };
+
+  std::string hits;
+  int damage_total = 0;
+
+  void on_damage(const damage& event)
+  {
+    hits += 'd';
+    damage_total += event.amount;
+  }
+
+  void on_fire(const fire_damage& event) { hits += 'f'; damage_total += event.heat; }
+
+}
+
+GES_TEST(hierarchy_listeners_are_flattened)
+{
+  ges::dispatcher events;
+
+  // a base listener registered before the hierarchy is declared is copied over
+  events.listen<damage, on_damage>();
+  events.inherit<fire_damage, damage>().inherit<poison_damage, damage>().inherit<burn, fire_damage>();
+  events.listen<fire_damage, on_fire>();
+
+  hits.clear();
+  damage_total = 0;
+
+  events.emit<damage>(damage{ 1 });
+  events.emit<fire_damage>(fire_damage{ { 10 }, 100 });
+  events.emit<poison_damage>(poison_damage{ { 1000 }, 3 });
+  events.emit<burn>(burn{ { { 10000 }, 100000 } });
+  events.run();
+
+  GES_CHECK(damage_total == 111111);
+  GES_CHECK(hits.size() == 6);
+  GES_CHECK(std::count(hits.begin(), hits.end(), 'f') == 2);
+
+  // kept in sync, including the types inheriting further down
+  events.unlisten<damage, on_damage>();
+
+  hits.clear();
+  events.emit<burn>(burn{ { { 1 }, 2 } });
+  events.emit<poison_damage>(poison_damage{ { 1 }, 1 });
+
+  // nobody is left to see a poison_damage, it isn't even stored
+  GES_CHECK(events.stats<poison_damage>().used == 0);
+
+  events.run();
+
+  GES_CHECK(hits == "f");
+}
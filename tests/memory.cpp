@@ -0,0 +1,229 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct counter { int value; };
+  struct message { std::string text; };
+
+  int total = 0;
+  std::vector<std::string> texts;
+
+  void on_counter(const counter& event) { total += event.value; }
+  void on_message(const message& event) { texts.push_back(event.text); }
+
+  // emits 'count' counters, returns how many were stored
+  int fill(ges::dispatcher& events, int count)
+  {
+    int stored = 0;
+
+    for(int i = 0; i < count; ++i)
+      stored += events.try_emit<counter>(counter{ 1 });
+
+    return stored;
+  }
+
+}
+
+GES_TEST(budget_reject_is_reported)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>();
+  events.set_policy<counter>({ .budget = 10 * sizeof(counter), .overflow = ges::overflow_policy::reject });
+
+  GES_CHECK(fill(events, 20) == 10);
+
+  const auto stats = events.stats<counter>();
+
+  GES_CHECK(stats.used == 10 * sizeof(counter));
+  GES_CHECK(stats.reserved <= 10 * sizeof(counter));
+  GES_CHECK(stats.rejected == 10 && stats.dropped == 0);
+
+  total = 0;
+  events.run();
+  GES_CHECK(total == 10);
+
+  // nobody listens, skipped without failing
+  GES_CHECK(events.try_emit<message>(message{ "unheard" }));
+}
+
+GES_TEST(budget_drop_newest)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>();
+  events.set_policy<counter>({ .budget = 10 * sizeof(counter), .overflow = ges::overflow_policy::drop_newest });
+
+  GES_CHECK(fill(events, 20) == 10);
+
+  const auto stats = events.stats<counter>();
+
+  GES_CHECK(stats.dropped == 10 && stats.rejected == 0);
+  GES_CHECK(events.stats().dropped == 10);
+}
+
+GES_TEST(budget_drop_oldest)
+{
+  ges::dispatcher events;
+  events.listen<message, on_message>();
+  events.set_policy<message>({ .budget = 4 * sizeof(message), .overflow = ges::overflow_policy::drop_oldest });
+
+  for(int i = 0; i < 8; ++i)
+    GES_CHECK(events.try_emit<message>(message{ std::to_string(i) }));
+
+  GES_CHECK(events.stats<message>().dropped == 4);
+
+  texts.clear();
+  events.run();
+
+  GES_CHECK((texts == std::vector<std::string>{ "4", "5", "6", "7" }));
+}
+
+namespace {
+
+  ges::dispatcher* current = nullptr;
+  std::vector<int> counted;
+
+  // emits to its own type into a full pool
+  void on_counter_emit(const counter& event)
+  {
+    counted.push_back(event.value);
+
+    if(event.value == 0)
+      current->emit<counter>(counter{ 99 });
+  }
+
+}
+
+GES_TEST(budget_drop_oldest_keeps_the_pass)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<counter, on_counter_emit>();
+  events.set_policy<counter>({ .budget = 3 * sizeof(counter), .overflow = ges::overflow_policy::drop_oldest });
+
+  counted.clear();
+
+  for(int i = 0; i < 3; ++i)
+    events.emit<counter>(counter{ i });
+
+  events.run();
+
+  // the batch being dispatched stays whole, the newest event is dropped instead
+  GES_CHECK((counted == std::vector<int>{ 0, 1, 2 }));
+  GES_CHECK(events.stats<counter>().dropped == 1);
+
+  // between passes the oldest go first again
+  for(int i = 1; i < 5; ++i)
+    events.emit<counter>(counter{ i });
+
+  counted.clear();
+  events.run();
+
+  GES_CHECK((counted == std::vector<int>{ 2, 3, 4 }));
+  GES_CHECK(events.stats<counter>().dropped == 2);
+}
+
+GES_TEST(budget_spill_is_released)
+{
+  ges::dispatcher events;
+  events.listen<message, on_message>();
+  events.set_policy<message>({ .budget = 2 * sizeof(message), .overflow = ges::overflow_policy::spill });
+
+  for(int i = 0; i < 8; ++i)
+    events.emit<message>(message{ std::to_string(i) });
+
+  auto stats = events.stats<message>();
+
+  GES_CHECK(stats.used == 8 * sizeof(message));
+  GES_CHECK(stats.spilled == 6);
+
+  texts.clear();
+  events.run();
+
+  GES_CHECK(texts.size() == 8);
+  GES_CHECK(events.stats<message>().reserved <= 2 * sizeof(message));
+}
+
+GES_TEST(high_water_mark_decay)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>();
+  events.set_policy<counter>({ .decay_frames = 2 });
+
+  fill(events, 1000);
+  events.run();
+  events.emit<counter>(counter{ 1 });
+  events.run();
+
+  // the spike is still within the decay window
+  GES_CHECK(events.stats<counter>().reserved >= 1000 * sizeof(counter));
+
+  events.run();
+  events.run();
+
+  GES_CHECK(events.stats<counter>().reserved == 0);
+}
+
+GES_TEST(global_budget_and_trim)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>();
+  events.set_budget(64);
+
+  GES_CHECK(fill(events, 100) == int(64 / sizeof(counter)));
+
+  const auto stats = events.stats();
+
+  GES_CHECK(stats.reserved <= 64);
+  GES_CHECK(stats.rejected == 100 - 64 / sizeof(counter));
+
+  events.run();
+  events.trim();
+
+  GES_CHECK(events.stats().reserved == 0);
+}
+
+GES_TEST(global_spill_is_released)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>().listen<message, on_message>();
+  events.set_budget(256);
+  events.set_policy<message>({ .overflow = ges::overflow_policy::spill });
+
+  for(int i = 0; i < 100; ++i)
+    events.emit<message>(message{ std::to_string(i) });
+
+  GES_CHECK(events.stats<message>().spilled > 0);
+  GES_CHECK(events.reserved() > 256);
+
+  texts.clear();
+  events.run();
+
+  GES_CHECK(texts.size() == 100);
+  GES_CHECK(events.reserved() <= 256);
+
+  // the next frame, another type has the budget again
+  total = 0;
+  GES_CHECK(fill(events, 16) == 16);
+
+  events.run();
+  GES_CHECK(total == 16);
+}
+
+GES_TEST(clear_releases_the_budget)
+{
+  ges::dispatcher events;
+  events.listen<counter, on_counter>().listen<message, on_message>();
+  events.set_budget(64);
+
+  GES_CHECK(fill(events, 100) == int(64 / sizeof(counter)));
+  GES_CHECK(events.reserved() == 64);
+
+  events.clear<counter>();
+
+  GES_CHECK(events.reserved() == 0);
+  GES_CHECK(events.try_emit<message>(message{ "fits" }));
+}
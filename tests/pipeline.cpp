@@ -0,0 +1,277 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <ges/worker_pool.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace {
+
+  struct input { int value; };
+  struct physics { int value; };
+  struct render { int value; };
+  struct chain { int left; };
+
+  ges::dispatcher* current = nullptr;
+  std::string order;
+  std::atomic<int> rendered = 0;
+  int chained = 0;
+
+  void on_input(const input& event)
+  {
+    order += 'i';
+    current->emit<physics>(physics{ event.value });
+  }
+
+  void on_physics(const physics& event)
+  {
+    order += 'p';
+    current->emit<render>(render{ event.value });
+  }
+
+  void on_render(const render& event)
+  {
+    order += 'r';
+    rendered += event.value;
+  }
+
+  // emits to its own type until 'left' runs out
+  void on_chain(const chain& event)
+  {
+    const int left = event.left;
+
+    ++chained;
+
+    if(left)
+      current->emit<chain>(chain{ left - 1 });
+  }
+
+}
+
+GES_TEST(pipeline_follows_emits_within_a_frame)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  // registered backwards, so only the declarations order them
+  events.listen<render, on_render>().listen<physics, on_physics>().listen<input, on_input>();
+  events.emits<input, physics>().emits<physics, render>();
+
+  order.clear();
+  rendered = 0;
+
+  events.emit<input>(input{ 5 });
+  events.run();
+
+  GES_CHECK(order == "ipr");
+  GES_CHECK(rendered == 5);
+}
+
+GES_TEST(pipeline_phases_come_first)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<render, on_render>().listen<physics, on_physics>().listen<input, on_input>();
+  events.emits<input, physics>().emits<physics, render>();
+
+  // render belongs to an earlier phase, what physics emits waits for the next frame
+  events.set_phase<input>(1).set_phase<physics>(1).set_phase<render>(0);
+
+  order.clear();
+  rendered = 0;
+
+  events.emit<input>(input{ 3 });
+  events.run();
+
+  GES_CHECK(order == "ip");
+  GES_CHECK(rendered == 0);
+
+  events.run();
+
+  GES_CHECK(order == "ipr");
+  GES_CHECK(rendered == 3);
+}
+
+GES_TEST(pipeline_run_parallel)
+{
+  ges::worker_pool workers{ 3 };
+  ges::dispatcher events;
+  current = &events;
+
+  events.set_workers(workers);
+  events.listen<render, on_render>().listen<physics, on_physics>().listen<input, on_input>();
+  events.emits<input, physics>().emits<physics, render>();
+
+  order.clear();
+  rendered = 0;
+
+  for(int i = 0; i < 100; ++i)
+    events.emit<input>(input{ 1 });
+
+  events.run_parallel();
+
+  GES_CHECK(rendered == 100);
+  GES_CHECK(order.find('r') > order.rfind('p'));
+}
+
+GES_TEST(self_emitted_events_wait_for_the_next_pass)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<chain, on_chain>();
+
+  chained = 0;
+  events.emit<chain>(chain{ 2 });
+  events.run();
+
+  GES_CHECK(chained == 1);
+  GES_CHECK(events.view<chain>().size() == 1);
+
+  events.run();
+  events.run();
+
+  GES_CHECK(chained == 3);
+  GES_CHECK(events.view<chain>().empty());
+}
+
+GES_TEST(run_for_self_emitted_events_wait_for_the_next_pass)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<chain, on_chain>();
+
+  chained = 0;
+  events.emit<chain>(chain{ 2 });
+
+  // the pass reaches the frame boundary, the handler ran once
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+  GES_CHECK(chained == 1);
+  GES_CHECK(events.view<chain>().size() == 1);
+
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+
+  GES_CHECK(chained == 3);
+  GES_CHECK(events.view<chain>().empty());
+
+  // one that re-emits forever still lets every call finish its pass
+  chained = 0;
+  events.emit<chain>(chain{ -1 });
+
+  for(int frame = 1; frame <= 5; ++frame)
+  {
+    GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+    GES_CHECK(chained == frame);
+  }
+
+  events.clear<chain>();
+}
+
+namespace {
+
+  struct urgent { int value; };
+  struct cosmetic { int value; };
+
+  std::string budgeted;
+
+  void on_urgent_first(const urgent& event) { budgeted += 'U'; budgeted += char('0' + event.value); }
+  void on_urgent_second(const urgent& event) { budgeted += 'u'; budgeted += char('0' + event.value); }
+  void on_cosmetic(const cosmetic& event) { budgeted += 'c'; budgeted += char('0' + event.value); }
+  void on_urgent_late(const urgent& event) { budgeted += 'L'; budgeted += char('0' + event.value); }
+
+}
+
+GES_TEST(run_for_resumes_where_it_stopped)
+{
+  ges::dispatcher events;
+
+  events.listen<cosmetic, on_cosmetic>();
+  events.listen<urgent, on_urgent_second>().listen<urgent, on_urgent_first>();
+
+  // cosmetic was registered first, the priority puts urgent ahead
+  events.set_priority<urgent>(1);
+
+  events.emit<cosmetic>(cosmetic{ 1 });
+  events.emit<cosmetic>(cosmetic{ 2 });
+  events.emit<urgent>(urgent{ 1 });
+  events.emit<urgent>(urgent{ 2 });
+
+  budgeted.clear();
+
+  // a spent budget still makes a handler call of progress
+  int calls = 1;
+
+  while(!events.run_for(std::chrono::nanoseconds{ 0 }))
+    ++calls;
+
+  GES_CHECK(budgeted == "U1u1U2u2c1c2");
+  GES_CHECK(calls >= 6);
+
+  // nothing is left for the next pass
+  budgeted.clear();
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+  GES_CHECK(budgeted.empty());
+}
+
+GES_TEST(run_for_keeps_the_listeners_it_started_with)
+{
+  ges::dispatcher events;
+
+  events.listen<urgent, on_urgent_second>().listen<urgent, on_urgent_first>();
+
+  events.emit<urgent>(urgent{ 1 });
+  events.emit<urgent>(urgent{ 2 });
+
+  budgeted.clear();
+
+  // a listener joins after the first handler call, it waits for the next pass
+  GES_CHECK(!events.run_for(std::chrono::nanoseconds{ 0 }));
+  events.listen<urgent, on_urgent_late>();
+
+  while(!events.run_for(std::chrono::nanoseconds{ 0 }));
+
+  GES_CHECK(budgeted == "U1u1U2u2");
+
+  events.emit<urgent>(urgent{ 3 });
+  events.emit<urgent>(urgent{ 4 });
+
+  budgeted.clear();
+
+  // and one leaving after the first handler call still sees the rest of the pass
+  GES_CHECK(!events.run_for(std::chrono::nanoseconds{ 0 }));
+  GES_CHECK((events.unlisten<urgent, on_urgent_first>()));
+
+  while(!events.run_for(std::chrono::nanoseconds{ 0 }));
+
+  GES_CHECK(budgeted == "L3U3u3L4U4u4");
+
+  budgeted.clear();
+  events.emit<urgent>(urgent{ 5 });
+
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+  GES_CHECK(budgeted == "L5u5");
+}
+
+GES_TEST(run_for_defers_events_emitted_to_passed_types)
+{
+  ges::dispatcher events;
+  current = &events;
+
+  events.listen<render, on_render>().listen<physics, on_physics>();
+  events.set_priority<render>(1);
+
+  order.clear();
+  rendered = 0;
+
+  events.emit<physics>(physics{ 4 });
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+
+  // render went first, what physics emitted waits
+  GES_CHECK(order == "p" && rendered == 0);
+
+  GES_CHECK(events.run_for(std::chrono::seconds{ 1 }));
+  GES_CHECK(order == "pr" && rendered == 4);
+}
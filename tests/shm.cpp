@@ -0,0 +1,189 @@
+#include "test.hpp"
+#include <ges/shm_queue.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+  struct sample { uint32_t id; float value; };
+
+  // 'check' is always the complement of 'value', a torn copy breaks it
+  struct guarded {
+    uint64_t value;
+    uint64_t padding[6];
+    uint64_t check;
+  };
+
+  std::string segment(const char* name)
+  {
+    return "/ges-test-" + std::to_string(::getpid()) + "-" + name;
+  }
+
+}
+
+GES_TEST(shm_round_trip)
+{
+  const auto name = segment("round-trip");
+
+  ges::shm_queue queue;
+  GES_CHECK(queue.open(name.c_str(), 4096));
+
+  ges::shm_reader reader;
+  GES_CHECK(reader.attach(name.c_str()));
+
+  for(uint32_t i = 0; i < 10; ++i)
+    queue.push<sample>(sample{ i, i * 0.5f });
+
+  uint32_t next = 0;
+  bool in_order = true;
+
+  const size_t consumed = reader.poll([&](mq::shash_t type, const void* event, uint32_t size) {
+    const auto* value = ges::shm_reader::cast<sample>(type, event);
+
+    in_order &= value && size == sizeof(sample) && value->id == next && value->value == next * 0.5f;
+    ++next;
+  });
+
+  GES_CHECK(consumed == 10 && in_order);
+  GES_CHECK(reader.overruns() == 0);
+
+  // wraps around the ring a few times while keeping up
+  for(uint32_t i = 0; i < 1000; ++i)
+  {
+    queue.push<sample>(sample{ i, 0.f });
+    GES_CHECK(reader.poll([](mq::shash_t, const void*, uint32_t) { }) == 1);
+  }
+
+  GES_CHECK(reader.overruns() == 0);
+}
+
+GES_TEST(shm_peek_reads_in_place)
+{
+  const auto name = segment("peek");
+
+  ges::shm_queue queue;
+  GES_CHECK(queue.open(name.c_str(), 512));
+
+  ges::shm_reader reader;
+  GES_CHECK(reader.attach(name.c_str()));
+
+  ges::shm_reader::event_view event;
+  GES_CHECK(!reader.peek(event));
+
+  // wraps around the ring, padding included
+  uint32_t next = 0;
+  bool in_order = true;
+
+  for(uint32_t i = 0; i < 100; ++i)
+  {
+    queue.push<sample>(sample{ i, 0.f });
+
+    while(reader.peek(event))
+    {
+      const auto* value = ges::shm_reader::cast<sample>(event.type, event.data);
+      const uint32_t id = value ? value->id : ~0u;
+
+      GES_CHECK(reader.validate(event));
+
+      in_order &= id == next++;
+      reader.pop(event);
+    }
+  }
+
+  GES_CHECK(next == 100 && in_order);
+  GES_CHECK(reader.overruns() == 0);
+
+  // an event the writer reused under the reader fails the check
+  queue.push<sample>(sample{ 1, 0.f });
+  GES_CHECK(reader.peek(event));
+
+  for(uint32_t i = 0; i < 100; ++i)
+    queue.push<sample>(sample{ i, 0.f });
+
+  GES_CHECK(!reader.validate(event));
+  GES_CHECK(!reader.peek(event) && reader.overruns() == 1);
+}
+
+GES_TEST(shm_overrun_skips_to_the_head)
+{
+  const auto name = segment("overrun");
+
+  ges::shm_queue queue;
+  GES_CHECK(queue.open(name.c_str(), 1024));
+
+  ges::shm_reader reader;
+  GES_CHECK(reader.attach(name.c_str()));
+
+  for(uint32_t i = 0; i < 1000; ++i)
+    queue.push<sample>(sample{ i, 0.f });
+
+  GES_CHECK(reader.poll([](mq::shash_t, const void*, uint32_t) { }) == 0);
+  GES_CHECK(reader.overruns() == 1 && reader.lost() > 0);
+
+  queue.push<sample>(sample{ 7, 0.f });
+
+  uint32_t id = 0;
+  GES_CHECK(reader.poll([&](mq::shash_t type, const void* event, uint32_t) { id = ges::shm_reader::cast<sample>(type, event)->id; }) == 1);
+  GES_CHECK(id == 7);
+}
+
+GES_TEST(shm_reader_never_sees_torn_events)
+{
+  const auto name = segment("torn");
+
+  ges::shm_queue queue;
+  GES_CHECK(queue.open(name.c_str(), 1024));
+
+  ges::shm_reader reader;
+  GES_CHECK(reader.attach(name.c_str()));
+
+  std::atomic<bool> done = false;
+
+  // a writer that laps the reader all the time
+  std::thread writer([&] {
+    for(uint64_t i = 0; !done; ++i)
+    {
+      queue.push<guarded>(guarded{ i, {}, ~i });
+
+      if(i % 4 == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 1 };
+
+  size_t seen = 0;
+  size_t torn = 0;
+
+  while(seen < 1000 && std::chrono::steady_clock::now() < deadline)
+  {
+    seen += reader.poll([&](mq::shash_t type, const void* event, uint32_t) {
+      const auto* value = ges::shm_reader::cast<guarded>(type, event);
+
+      if(!value)
+      {
+        ++torn;
+        return;
+      }
+
+      // slow enough to be overwritten while looking at it
+      const uint64_t first = value->value;
+      std::this_thread::yield();
+
+      torn += value->check != ~first;
+    });
+  }
+
+  done = true;
+  writer.join();
+
+  GES_CHECK(torn == 0);
+  GES_CHECK(seen > 0);
+}
+
+#endif // defined(__unix__) || defined(__APPLE__)
@@ -0,0 +1,140 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <ges/frame_allocator.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct input { int frame; };
+  struct chat { std::string text; };
+
+  std::vector<int> inputs;
+  std::vector<std::string> chats;
+
+  void on_input(const input& event) { inputs.push_back(event.frame); }
+  void on_chat(const chat& event) { chats.push_back(event.text); }
+
+}
+
+GES_TEST(snapshot_restores_pools_and_bus)
+{
+  ges::dispatcher events;
+  events.listen<input, on_input>().listen<chat, on_chat>();
+
+  events.emit<input>(input{ 1 });
+  events.emit<input>(input{ 2 });
+  events.emit<chat>(chat{ std::string(40, 'h') });
+  events.emit_bus<input>(input{ 3 });
+
+  const ges::frame_snapshot state = events.snapshot();
+
+  // resimulated twice from the same capture
+  for(int pass = 0; pass < 2; ++pass)
+  {
+    inputs.clear();
+    chats.clear();
+
+    events.run();
+    events.run_bus();
+
+    GES_CHECK((inputs == std::vector<int>{ 1, 2, 3 }));
+    GES_CHECK(chats.size() == 1 && chats[0] == std::string(40, 'h'));
+
+    events.restore(state);
+  }
+
+  // events pending when restoring are replaced
+  events.emit<input>(input{ 9 });
+  events.restore(state);
+
+  inputs.clear();
+  events.run();
+
+  GES_CHECK((inputs == std::vector<int>{ 1, 2 }));
+}
+
+GES_TEST(snapshot_reuses_its_memory)
+{
+  ges::dispatcher events;
+  events.listen<chat, on_chat>();
+
+  ges::frame_snapshot state;
+
+  for(int frame = 0; frame < 3; ++frame)
+  {
+    events.emit<chat>(chat{ std::to_string(frame) });
+    events.snapshot(state);
+    events.run();
+  }
+
+  chats.clear();
+  events.restore(state);
+  events.run();
+
+  GES_CHECK((chats == std::vector<std::string>{ "2" }));
+
+  // the capture only holds what was pending
+  events.snapshot(state);
+
+  chats.clear();
+  events.emit<chat>(chat{ "later" });
+  events.restore(state);
+  events.run();
+
+  GES_CHECK(chats.empty());
+}
+
+namespace {
+
+  struct whisper {
+    ges::frame_string text;
+  };
+
+  std::vector<std::string> whispers;
+
+  void on_whisper(const whisper& event) { whispers.emplace_back(event.text); }
+
+}
+
+template<> inline constexpr bool ges::is_frame_scoped_v<whisper> = true;
+
+GES_TEST(snapshot_leaves_frame_scoped_events_out)
+{
+  ges::dispatcher events;
+  events.listen<input, on_input>().listen<whisper, on_whisper>();
+
+  auto* memory = events.frame_memory();
+
+  events.emit<input>(input{ 1 });
+  events.emit<whisper>(ges::frame_string{ std::string(64, 'w'), memory });
+  events.emit_bus<whisper>(ges::frame_string{ std::string(64, 'b'), memory });
+  events.emit_bus<input>(input{ 2 });
+
+  const auto state = events.snapshot();
+
+  inputs.clear();
+  whispers.clear();
+
+  events.run();
+  events.run_bus();
+
+  GES_CHECK((inputs == std::vector<int>{ 1, 2 }));
+  GES_CHECK(whispers.size() == 2);
+
+  // the frame memory the whispers used is long gone, only the rest comes back
+  events.run();
+  events.run();
+
+  inputs.clear();
+  whispers.clear();
+
+  events.restore(state);
+  GES_CHECK(events.stats_bus().pending == 1);
+
+  events.run();
+  events.run_bus();
+
+  GES_CHECK((inputs == std::vector<int>{ 1, 2 }));
+  GES_CHECK(whispers.empty());
+}
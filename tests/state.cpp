@@ -0,0 +1,177 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  struct rtt { int value; };
+
+  // three words written together, a torn read mixes them up
+  struct transform { uint64_t x, y, z; };
+
+  std::string seen;
+  int transforms_seen = 0;
+
+  void on_rtt(const rtt& event) { seen += std::to_string(event.value) + ' '; }
+
+  void on_rtt_of(const ges::state_update<rtt>& update)
+  {
+    seen += std::to_string(update.key) + '=' + std::to_string(update.value.value) + ' ';
+  }
+  void on_transform(const transform&) { ++transforms_seen; }
+
+  template<int N>
+  struct noise { int value; };
+
+  template<int N>
+  void on_noise(const noise<N>&) { }
+
+  template<int... N>
+  void register_noise(ges::dispatcher& events, std::integer_sequence<int, N...>)
+  {
+    (events.listen<noise<N>, on_noise<N>>(), ...);
+  }
+
+}
+
+GES_TEST(state_runs_listeners_once_per_change)
+{
+  ges::dispatcher events;
+  events.set_state<rtt>();
+  events.listen<rtt, on_rtt>();
+
+  seen.clear();
+
+  GES_CHECK(events.publish(rtt{ 10 }));
+  GES_CHECK(events.publish(rtt{ 20 }));
+  events.run();
+
+  // only the latest value, once
+  GES_CHECK(seen == "20 ");
+  GES_CHECK(events.state<rtt>().get().value == 20);
+
+  // unchanged values are skipped
+  GES_CHECK(!events.publish(rtt{ 20 }));
+  events.run();
+
+  GES_CHECK(seen == "20 ");
+
+  GES_CHECK(events.publish(rtt{ 30 }));
+  events.run();
+  events.run();
+
+  GES_CHECK(seen == "20 30 ");
+}
+
+GES_TEST(state_keeps_a_slot_per_key)
+{
+  ges::dispatcher events;
+  auto& channel = events.set_state<rtt>(4);
+  events.listen<rtt, on_rtt>();
+
+  seen.clear();
+
+  channel.publish(2, rtt{ 2 });
+  channel.publish(0, rtt{ 1 });
+  channel.publish(2, rtt{ 3 });
+  events.run();
+
+  // the keys that changed, in key order
+  GES_CHECK(seen == "1 3 ");
+  GES_CHECK(channel.get(1).value == 0 && channel.get(2).value == 3);
+  GES_CHECK(channel.version(2) == 2 && channel.version(3) == 0);
+
+  // declared again, the same channel
+  GES_CHECK(&events.set_state<rtt>(4) == &channel);
+  GES_CHECK(&events.state<rtt>() == &channel);
+}
+
+GES_TEST(state_updates_carry_the_key)
+{
+  ges::dispatcher events;
+  auto& channel = events.set_state<rtt>(4);
+  events.listen<ges::state_update<rtt>, on_rtt_of>();
+
+  seen.clear();
+
+  channel.publish(3, rtt{ 42 });
+  channel.publish(1, rtt{ 7 });
+  events.run();
+
+  GES_CHECK(seen == "1=7 3=42 ");
+
+  // along with the listeners of the value alone
+  events.listen<rtt, on_rtt>();
+
+  seen.clear();
+  channel.publish(3, rtt{ 43 });
+  events.run();
+
+  GES_CHECK(seen == "43 3=43 ");
+
+  GES_CHECK((events.unlisten<ges::state_update<rtt>, on_rtt_of>()));
+
+  seen.clear();
+  channel.publish(1, rtt{ 8 });
+  events.run();
+
+  GES_CHECK(seen == "8 ");
+}
+
+GES_TEST(state_is_read_and_written_from_any_thread)
+{
+  ges::dispatcher events;
+  auto& channel = events.set_state<transform>(2);
+  events.listen<transform, on_transform>();
+
+  transforms_seen = 0;
+
+  std::atomic<bool> done = false;
+  std::atomic<int> torn = 0;
+
+  std::vector<std::thread> threads;
+
+  // a writer per key, one on the cached channel and one looking the state up
+  threads.emplace_back([&] {
+    for(uint64_t i = 1; !done; ++i)
+      channel.publish(0, transform{ i, i * 2, i * 3 });
+  });
+
+  threads.emplace_back([&] {
+    for(uint64_t i = 1; !done; ++i)
+      events.publish(1, transform{ i, i * 2, i * 3 });
+  });
+
+  threads.emplace_back([&] {
+    while(!done)
+    {
+      for(size_t key : { 0u, 1u })
+      {
+        const auto value = (key ? events.state<transform>() : channel).get(key);
+        torn += value.y != value.x * 2 || value.z != value.x * 3;
+      }
+    }
+  });
+
+  // the main thread keeps registering types and running frames meanwhile
+  register_noise(events, std::make_integer_sequence<int, 100>{});
+
+  // until both writers got going, they may not be scheduled before the frames are done
+  for(int frame = 0; frame < 200 || !channel.get(0).x || !channel.get(1).x; ++frame)
+    events.run();
+
+  done = true;
+
+  for(auto& thread : threads)
+    thread.join();
+
+  events.run();
+
+  GES_CHECK(torn == 0);
+  GES_CHECK(transforms_seen > 0);
+  GES_CHECK(channel.get(0).x > 0 && channel.get(1).x > 0);
+}
@@ -1,3 +1,4 @@
+#include "test.hpp"
 #include <ges/dispatcher.hpp>
 #include <iostream>
 #include <string>
@@ -127,7 +128,7 @@ static void test_events(const ges::viewer<test_event>& view)
   }
 }
 
-int main()
+GES_TEST(smoke)
 {
   message_notifier notifications;
   
@@ -148,17 +149,19 @@ int main()
   dispatcher.listen<key_event, on_key_event>();
   for (int i = 0; i < 10; i++)
   {
-    dispatcher.send<test_event>();
+    dispatcher.emit<test_event>();
   }
 
-  dispatcher.send(key_event{ 1, true, true });
+  dispatcher.trigger(key_event{ 1, true, true });
 
-  dispatcher.enqueue<chat_message>("Liam", "How are you doing guys?");
+  dispatcher.emit<chat_message>("Liam", "How are you doing guys?");
 
   if (dispatcher.contains<test_event>())
     std::cout << "test_event is registered\n";
   
   dispatcher.run();
+
+  GES_CHECK(glob == 10);
   
   if (dispatcher.unlisten<chat_message, &message_notifier::notify>(&notifications))
   {
@@ -180,5 +183,15 @@ int main()
     std::cout << "he-he: " << event.name << std::endl;
   }
 
+  GES_CHECK(view.size() == 10);
+
   dispatcher.run();
+
+  GES_CHECK(glob == 20);
+}
+
+// an argument runs the tests whose name contains it
+int main(int argc, char** argv)
+{
+  return ges::test::run(argc > 1 ? argv[1] : nullptr) ? 1 : 0;
 }
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// a minimal runner, GES_TEST registers a test and GES_CHECK counts the failed checks
+namespace ges::test {
+
+  struct test_case {
+    const char* name;
+    void(*function)();
+  };
+
+  inline std::vector<test_case>& registry()
+  {
+    static std::vector<test_case> tests;
+    return tests;
+  }
+
+  inline int failures = 0;
+
+  struct registrar {
+    registrar(const char* name, void(*function)())
+    {
+      registry().push_back(test_case{ name, function });
+    }
+  };
+
+  inline bool check(bool passed, const char* expression, const char* file, int line)
+  {
+    if(!passed)
+    {
+      ++failures;
+      std::printf("%s:%d: check failed: %s\n", file, line, expression);
+    }
+
+    return passed;
+  }
+
+  // runs the tests whose name contains 'filter', every one without a filter.
+  // Returns the number of failed checks
+  inline int run(const char* filter = nullptr)
+  {
+    for(const auto& test : registry())
+    {
+      if(filter && !std::strstr(test.name, filter))
+        continue;
+
+      const int before = failures;
+
+      test.function();
+
+      std::printf("%s %s\n", failures == before ? "[ ok ]" : "[fail]", test.name);
+    }
+
+    return failures;
+  }
+
+} // namespace ges::test
+
+#define GES_TEST(name) \
+  static void name(); \
+  static const ges::test::registrar name##_registrar{ #name, &name }; \
+  static void name()
+
+#define GES_CHECK(expression) ges::test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,79 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <ges/tracer.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+  struct frame_tick { int value; };
+
+  void on_frame_tick(const frame_tick&) { }
+
+  size_t occurrences(const std::string& text, const std::string& pattern)
+  {
+    size_t count = 0;
+
+    for(auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+      ++count;
+
+    return count;
+  }
+
+  std::string dumped(const ges::tracer& tracer)
+  {
+    std::ostringstream out;
+    tracer.dump(out);
+    return out.str();
+  }
+
+}
+
+GES_TEST(tracer_records_dispatch_spans)
+{
+  ges::tracer tracer;
+  ges::dispatcher events;
+
+  events.set_tracer(&tracer);
+  events.listen<frame_tick, on_frame_tick>();
+
+  events.emit<frame_tick>(frame_tick{ 1 });
+  events.run();
+
+  const auto json = dumped(tracer);
+
+  GES_CHECK(json.starts_with("{\"traceEvents\":[") && json.ends_with("]}"));
+  GES_CHECK(occurrences(json, "\"cat\":\"run\"") == 1);
+  GES_CHECK(occurrences(json, "\"cat\":\"listeners\"") == 1);
+  GES_CHECK(json.find("frame_tick") != std::string::npos);
+
+  tracer.clear();
+  GES_CHECK(dumped(tracer) == "{\"traceEvents\":[]}");
+}
+
+GES_TEST(tracer_ring_per_thread)
+{
+  ges::tracer first{ 8 };
+  ges::tracer second{ 8 };
+
+  // switching between tracers finds the same ring again
+  for(int i = 0; i < 100; ++i)
+  {
+    first.record("first", ges::span_kind::run, 0, 1);
+    second.record("second", ges::span_kind::run, 0, 1);
+  }
+
+  std::thread other([&] { first.record("other", ges::span_kind::bus, 0, 1); });
+  other.join();
+
+  const auto json = dumped(first);
+
+  // the ring holds the last 8 spans of the thread, the other thread has its own
+  GES_CHECK(occurrences(json, "\"name\":\"first\"") == 8);
+  GES_CHECK(occurrences(json, "\"tid\":1}") == 8);
+  GES_CHECK(occurrences(json, "\"tid\":2}") == 1);
+  GES_CHECK(json.find("\"tid\":3}") == std::string::npos);
+
+  GES_CHECK(occurrences(dumped(second), "\"tid\":1}") == 8);
+}
@@ -0,0 +1,175 @@
+#include "test.hpp"
+#include <ges/dispatcher.hpp>
+#include <ges/worker_pool.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct unit { int entity; float depth; int index; };
+  struct sprite { int layer; int index; };
+
+  ges::dispatcher* current = nullptr;
+  std::atomic<int> unsorted = 0;
+  std::atomic<int> sorted_views = 0;
+
+  void on_unit(const unit&) { }
+  void on_sprite(const sprite&) { }
+
+  // checks the order of a sorted view from inside a viewer, equal keys keep the order of emission
+  template<typename EventType, auto member>
+  void check_sorted(ges::viewer<EventType>)
+  {
+    const auto events = current->view_sorted<EventType, member>();
+
+    for(size_t i = 1; i < events.size(); ++i)
+    {
+      const auto& prev = events.at(i - 1);
+      const auto& next = events.at(i);
+
+      unsorted += prev.*member > next.*member || (prev.*member == next.*member && prev.index > next.index);
+    }
+
+    ++sorted_views;
+  }
+
+  // spreads keys over several bytes so the radix passes run
+  int scramble(int i) { return (i * 7919) % 1000 - 500; }
+
+}
+
+GES_TEST(view_sorted_orders_and_groups)
+{
+  ges::dispatcher events;
+  events.listen<unit, on_unit>();
+
+  GES_CHECK((events.view_sorted<sprite, &sprite::layer>().empty()));
+
+  const int entities[] = { 3, 1, 2, 1, 3, 1 };
+
+  for(int i = 0; i < 6; ++i)
+    events.emit<unit>(unit{ entities[i], 0.f, i });
+
+  const auto by_entity = events.view_sorted<unit, &unit::entity>();
+
+  std::string seen;
+
+  for(const auto& group : by_entity.group_by())
+  {
+    seen += std::to_string(group.key()) + ':';
+
+    for(const auto& event : group)
+      seen += std::to_string(event.index);
+
+    seen += ' ';
+  }
+
+  GES_CHECK(seen == "1:135 2:2 3:04 ");
+
+  // the events themselves stay where they were emitted
+  GES_CHECK(events.view<unit>().at(0).entity == 3);
+}
+
+GES_TEST(view_sorted_radix_sorts_large_views)
+{
+  ges::dispatcher events;
+  events.listen<unit, on_unit>();
+
+  for(int i = 0; i < 1000; ++i)
+    events.emit<unit>(unit{ scramble(i), -0.5f * scramble(i), i });
+
+  const auto by_entity = events.view_sorted<unit, &unit::entity>();
+  const auto by_depth = events.view_sorted<unit, &unit::depth>();
+
+  GES_CHECK(by_entity.size() == 1000 && by_depth.size() == 1000);
+
+  int wrong = 0;
+
+  for(size_t i = 1; i < 1000; ++i)
+  {
+    wrong += by_entity.at(i - 1).entity > by_entity.at(i).entity;
+    wrong += by_depth.at(i - 1).depth > by_depth.at(i).depth;
+  }
+
+  GES_CHECK(wrong == 0);
+  GES_CHECK(by_entity.at(0).entity == -500 && by_depth.at(0).depth == -249.5f);
+
+  // shared until the events change
+  GES_CHECK((&events.view_sorted<unit, &unit::entity>().at(0) == &by_entity.at(0)));
+
+  events.run();
+  events.emit<unit>(unit{ 1, 0.f, 0 });
+  events.emit<unit>(unit{ 0, 0.f, 1 });
+
+  const auto fresh = events.view_sorted<unit, &unit::entity>();
+
+  GES_CHECK(fresh.size() == 2 && fresh.at(0).entity == 0);
+}
+
+GES_TEST(view_sorted_sees_batches_refilled_in_place)
+{
+  ges::dispatcher events;
+  events.listen<unit, on_unit>();
+
+  auto batch = events.batch<unit>();
+
+  for(int i = 0; i < 5; ++i)
+    batch.push_back(unit{ i, 0.f, i });
+
+  GES_CHECK((events.view_sorted<unit, &unit::entity>().at(0).entity == 0));
+
+  // as many events as before at the same address, in the opposite order
+  batch.reset();
+
+  const int entities[] = { 3, 1, 3, 0, 1 };
+
+  for(int i = 0; i < 5; ++i)
+    batch.push_back(unit{ entities[i], 0.f, i });
+
+  const auto by_entity = events.view_sorted<unit, &unit::entity>();
+
+  std::string seen;
+
+  for(size_t i = 0; i < by_entity.size(); ++i)
+    seen += std::to_string(by_entity.at(i).index);
+
+  GES_CHECK(seen == "31402");
+
+  seen.clear();
+
+  for(const auto& group : by_entity.group_by())
+    seen += std::to_string(group.key());
+
+  GES_CHECK(seen == "013");
+}
+
+GES_TEST(view_sorted_in_run_parallel)
+{
+  ges::worker_pool workers{ 3 };
+  ges::dispatcher events;
+  current = &events;
+
+  // independent types of one level are viewed side by side on the workers
+  events.set_workers(workers);
+  events
+    .listen<unit, on_unit>().listen_view<unit, check_sorted<unit, &unit::entity>>()
+    .listen<sprite, on_sprite>().listen_view<sprite, check_sorted<sprite, &sprite::layer>>();
+
+  unsorted = 0;
+  sorted_views = 0;
+
+  for(int frame = 0; frame < 50; ++frame)
+  {
+    for(int i = 0; i < 500; ++i)
+    {
+      events.emit<unit>(unit{ scramble(i + frame), 0.f, i });
+      events.emit<sprite>(sprite{ scramble(i * 3 + frame), i });
+    }
+
+    events.run_parallel();
+  }
+
+  GES_CHECK(sorted_views == 100);
+  GES_CHECK(unsorted == 0);
+}